@@ -0,0 +1,145 @@
+#ifndef AGGLOMERATIVE_H_
+#define AGGLOMERATIVE_H_
+
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+
+/* The upper triangle of a symmetric n x n distance matrix, row by row */
+class condensed_matrix {
+
+public:
+
+	condensed_matrix(size_t n, float value)
+		: n(n), distances(n * (n - 1) / 2, value) { }
+
+	size_t size() const
+	{
+		return n;
+	}
+
+	float & operator()(size_t i, size_t j)
+	{
+		return distances[index(i, j)];
+	}
+
+	float operator()(size_t i, size_t j) const
+	{
+		return distances[index(i, j)];
+	}
+
+private:
+	size_t index(size_t i, size_t j) const
+	{
+		if (i > j)
+			std::swap(i, j);
+		return n * i - i * (i + 1) / 2 + (j - i - 1);
+	}
+
+	size_t n;
+	std::vector<float> distances;
+
+};
+
+/*
+ * Linkage policies give the distance from a cluster k to the union of the
+ * clusters x and y, from the distances to both and the sizes. They are all
+ * reducible, which the nearest-neighbor chain relies on.
+ */
+struct complete_linkage {
+	static float merge(float dxk, float dyk, size_t, size_t)
+	{
+		return std::max(dxk, dyk);
+	}
+};
+
+struct single_linkage {
+	static float merge(float dxk, float dyk, size_t, size_t)
+	{
+		return std::min(dxk, dyk);
+	}
+};
+
+struct average_linkage {
+	static float merge(float dxk, float dyk, size_t size_x, size_t size_y)
+	{
+		return ((float) size_x * dxk + (float) size_y * dyk) / (float) (size_x + size_y);
+	}
+};
+
+struct merge_step {
+	size_t x, y;
+	float distance;
+};
+
+/*
+ * Agglomerates the items of the matrix with the nearest-neighbor chain,
+ * merging only the clusters closer than max_distance: O(n^2) time and no
+ * memory beyond the matrix, which is overwritten. Each step names both
+ * clusters by one of their items; merges_to_parents puts them in order.
+ */
+template<class linkage>
+void nn_chain_cluster(condensed_matrix &dist, float max_distance,
+	std::vector<merge_step> &merges)
+{
+	const size_t n = dist.size();
+	std::vector<bool> active(n, true);
+	std::vector<size_t> sizes(n, 1);
+	std::vector<size_t> chain;
+	size_t num_active = n;
+	size_t next_start = 0;
+
+	merges.clear();
+	chain.reserve(n);
+	while (num_active > 0) {
+		if (chain.empty()) {
+			while (!active[next_start])
+				next_start++;
+			chain.push_back(next_start);
+		}
+
+		const size_t a = chain.back();
+		size_t b = n;
+		float best = max_distance;
+		/* Prefer the previous link on ties, or the chain could cycle */
+		if (chain.size() >= 2) {
+			b = chain[chain.size() - 2];
+			best = dist(a, b);
+		}
+		for (size_t c = 0; c < n; c++) {
+			if (c != a && active[c] && dist(a, c) < best) {
+				best = dist(a, c);
+				b = c;
+			}
+		}
+
+		if (b == n) {
+			/* Nothing is close enough, and merges only move clusters apart */
+			active[a] = false;
+			num_active--;
+			chain.pop_back();
+			continue;
+		}
+
+		if (chain.size() >= 2 && b == chain[chain.size() - 2]) {
+			chain.pop_back();
+			chain.pop_back();
+			const size_t x = std::min(a, b), y = std::max(a, b);
+			merge_step step = { x, y, best };
+			merges.push_back(step);
+			for (size_t k = 0; k < n; k++) {
+				if (k != x && k != y && active[k])
+					dist(x, k) = linkage::merge(dist(x, k), dist(y, k), sizes[x], sizes[y]);
+			}
+			sizes[x] += sizes[y];
+			active[y] = false;
+			num_active--;
+		} else {
+			chain.push_back(b);
+		}
+	}
+}
+
+void merges_to_parents(size_t n, std::vector<merge_step> &merges, std::vector<int> &parents);
+
+#endif /* AGGLOMERATIVE_H_ */
@@ -5,6 +5,7 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include <stdio.h>
 
 struct dictionary_files {
@@ -13,10 +14,27 @@ struct dictionary_files {
 	FILE *time_file;
 };
 
+/*
+ * The sizes and modification times, in nanoseconds, of the .main, .words
+ * and .time files, which the files built from a dictionary record to
+ * recognize it.
+ */
+struct dictionary_fingerprint {
+	uint64_t main_size;
+	uint64_t word_size;
+	uint64_t time_size;
+	int64_t main_mtime;
+	int64_t word_mtime;
+	int64_t time_mtime;
+};
+
 int init_dictfiles(struct dictionary_files *files, const char *base_filename,
 	const char *mode);
 void destroy_dictfiles(struct dictionary_files *files);
 
+int fingerprint_dictionary(const char *base_filename, struct dictionary_fingerprint *fingerprint);
+int same_dictionary(const struct dictionary_fingerprint *a, const struct dictionary_fingerprint *b);
+
 #ifdef __cplusplus
 }
 #endif
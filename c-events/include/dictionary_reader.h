@@ -3,6 +3,8 @@
 
 #include "dictionary_files.h"
 #include "dictionary_types.h"
+#include "word_index.h"
+#include "word_stats.h"
 
 #define MAX_YEARS 509
 
@@ -17,6 +19,10 @@ struct dictionary_reader {
 	size_t num_words;
 	long long time_file_size;
 	long word_file_size;
+	int has_index;
+	struct word_index index;
+	int has_stats;
+	struct word_stats_file stats;
 	struct total_counts_entry frequencies[MAX_YEARS];
 };
 
@@ -31,6 +37,11 @@ int init_dictreader(struct dictionary_reader *dict, const char *base_filename);
 
 void destroy_dictreader(struct dictionary_reader *dict);
 
+int load_frequencies(struct total_counts_entry *frequencies,
+	const char *filename);
+
+long find_word(const struct dictionary_reader *dict, const char *word);
+
 int read_table(const struct dictionary_reader *dict, size_t index,
 	struct time_entry *table, size_t *table_size);
 
@@ -0,0 +1,12 @@
+#ifndef DOUBLE_CHANGE_H_
+#define DOUBLE_CHANGE_H_
+
+#include "series.h"
+
+#define NUM_CHANGE_RATIOS 9
+
+void double_change_scores(const double *series, int *counts);
+
+bool double_change_admissible(const double *series, const series_statistics *stats);
+
+#endif /* DOUBLE_CHANGE_H_ */
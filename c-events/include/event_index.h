@@ -0,0 +1,87 @@
+#ifndef EVENT_INDEX_H_
+#define EVENT_INDEX_H_
+
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+#define EVENT_INDEX_MAGIC "HEVEVIX"
+#define EVENT_INDEX_VERSION 1
+/* The history documents start with this year, as in zeitgeist.py */
+#define HISTORY_MIN_YEAR 250
+
+struct event_posting {
+	uint32_t id;
+	int32_t score;
+};
+
+/*
+ * Binary event indexes start with this header, in native byte order. The
+ * sections follow at the given offsets: the year offsets into the year
+ * postings (word id, score), then the word offsets into the word postings
+ * (year, score), then the offsets into the null-terminated words.
+ */
+struct event_index_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t num_years;
+	uint64_t num_words;
+	uint64_t num_postings;
+	uint64_t year_offsets_offset;
+	uint64_t year_postings_offset;
+	uint64_t word_offsets_offset;
+	uint64_t word_postings_offset;
+	uint64_t text_offsets_offset;
+	uint64_t text_offset;
+};
+
+/*
+ * Inverted index of the events of one detector, built while it runs. Words
+ * get ids in the order they emit their first event and finish() builds both
+ * posting lists, keeping the highest score of a word in a year.
+ */
+class event_index {
+
+public:
+
+	event_index(size_t num_years);
+
+	void begin_word(const char *word);
+
+	void add(unsigned int year, int score);
+
+	void finish();
+
+	size_t num_words() const;
+
+	const char * word(size_t id) const;
+
+	int write(FILE *f) const;
+
+	int export_history(FILE *f) const;
+
+	int export_revhist(FILE *f) const;
+
+private:
+	struct raw_event {
+		uint32_t year;
+		uint32_t word;
+		int32_t score;
+	};
+
+	bool is_document_word(size_t id) const;
+
+	size_t num_years;
+	const char *current_word;
+	bool word_added;
+	std::vector<char> text;
+	std::vector<uint64_t> text_offsets;
+	std::vector<raw_event> events;
+	std::vector<uint64_t> year_offsets;
+	std::vector<event_posting> year_postings;
+	std::vector<uint64_t> word_offsets;
+	std::vector<event_posting> word_postings;
+
+};
+
+#endif /* EVENT_INDEX_H_ */
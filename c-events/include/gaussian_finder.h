@@ -1,9 +1,11 @@
 #ifndef GAUSSIAN_FINDER_H_
 #define GAUSSIAN_FINDER_H_
 
+#include <map>
 #include <vector>
 #include <cmath>
 #include <cstdlib>
+#include "series.h"
 
 #define EPSILON 1e-6
 
@@ -35,9 +37,51 @@ struct gaussian_entry {
 
 };
 
+struct gaussian_entry_after {
+
+	bool operator()(const gaussian_entry &x, const gaussian_entry &y) const
+	{
+		return y < x;
+	}
+
+};
+
+/*
+ * Disjoint year intervals, keyed by their left end, which answers whether a
+ * new interval overlaps any of them in logarithmic time.
+ */
+class interval_index {
+
+public:
+
+	interval_index();
+
+	void clear();
+
+	bool overlaps(size_t left, size_t right) const;
+
+	void insert(size_t left, size_t right);
+
+	size_t covered() const;
+
+private:
+	std::map<size_t, size_t> intervals;
+	size_t num_covered;
+
+};
+
+/* Leaves the candidates as a heap, with the best candidate at the front. */
 void select_gaussians(const double *series, size_t inf, size_t sup, std::vector<gaussian_entry> &gaussians);
 
+/* Consumes the candidate heap, keeping the best non-overlapping candidates. */
+void pick_gaussians(std::vector<gaussian_entry> &gaussians, std::vector<gaussian_entry> &picked);
+
+void widen_gaussians(const std::vector<gaussian_entry> &picked,
+	std::vector< std::pair<size_t, int> > &counts, double widening);
+
 void relevant_gaussians(const std::vector<gaussian_entry> &gaussians,
 	std::vector< std::pair<size_t, int> > &counts, double widening);
 
+bool gaussians_admissible(const series_statistics &stats, double min_burstiness);
+
 #endif /* GAUSSIAN_FINDER_H_ */
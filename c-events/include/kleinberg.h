@@ -5,6 +5,8 @@
 #include <cstring>
 #include "file.h"
 #include "generic_processor.h"
+#include "relevance_matrix.h"
+#include "summary_sink.h"
 
 void init_ln_sums(size_t max_num_docs);
 bool batch_viterbi(const std::vector<unsigned int> &docs, const std::vector<unsigned int> &relevant,
@@ -15,7 +17,7 @@ class kleinberg_processor : public generic_processor {
 public:
 
 	kleinberg_processor(std::vector<unsigned int> &docs, std::vector<unsigned int> &relevant,
-		const char *filename);
+		const char *filename, relevance_format format = RELEVANCE_CSV);
 
 	virtual ~kleinberg_processor();
 
@@ -23,13 +25,18 @@ public:
 
 	virtual void compute_summary(const char *word);
 
+	void attach_index(event_index *index);
+
 	static kleinberg_processor * create(std::vector<unsigned int> &docs,
-		std::vector<unsigned int> &relevant, const char *filename);
+		std::vector<unsigned int> &relevant, const char *filename,
+		relevance_format format = RELEVANCE_CSV);
 
 private:
 	std::vector<unsigned int> &docs;
 	std::vector<unsigned int> &relevant;
 	excl_file efile;
+	relevance_matrix matrix;
+	summary_sink sink;
 
 };
 
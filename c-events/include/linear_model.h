@@ -1,6 +1,7 @@
 #ifndef LINEAR_MODEL_H_
 #define LINEAR_MODEL_H_
 
+#include "series.h"
 #include "static_array.h"
 
 #ifdef __cplusplus
@@ -23,10 +24,15 @@ void generate_ranges(struct static_array *ranges,
 
 void normalize_standard_score(double *data, size_t num_elems);
 
+void normalize_training_data(gsl_multimin_function_fdf *fdf);
+
 void normalize_generate_ranges(struct static_array *ranges,
 	const gsl_multimin_fdfminimizer_type *T,
 	gsl_multimin_function_fdf *fdf);
 
+int linear_model_admissible(const struct series_statistics *stats,
+	double min_burstiness);
+
 double regression_f(const gsl_vector *v, void *params);
 
 void regression_df(const gsl_vector *v, void *params, gsl_vector *df);
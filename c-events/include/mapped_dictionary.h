@@ -0,0 +1,66 @@
+#ifndef MAPPED_DICTIONARY_H_
+#define MAPPED_DICTIONARY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "dictionary_reader.h"
+#include "dictionary_types.h"
+#include "mapped_file.h"
+#include "word_index.h"
+
+/*
+ * A dictionary sorted by sorter, read in place from the mapped .main, .words
+ * and .time files, and from its .index when there is one. The functions
+ * named mapped_dictionary_* make up the API of libevents.so for ctypes,
+ * which only deals in pointers.
+ */
+struct mapped_dictionary {
+	struct mapped_file main_file;
+	struct mapped_file word_file;
+	struct mapped_file time_file;
+	const struct db_entry *database;
+	size_t num_words;
+	int has_index;
+	struct word_index index;
+	struct total_counts_entry frequencies[MAX_YEARS];
+};
+
+int init_mapped_dictionary(struct mapped_dictionary *self, const char *base_filename,
+	const char *total_counts_filename);
+
+void destroy_mapped_dictionary(struct mapped_dictionary *self);
+
+long find_mapped_word(const struct mapped_dictionary *self, const char *word, size_t length);
+
+void find_mapped_prefix(const struct mapped_dictionary *self, const char *prefix, size_t length,
+	size_t *first, size_t *last);
+
+void mapped_word_frequencies(const struct mapped_dictionary *self, size_t index, double *series);
+
+struct mapped_dictionary * mapped_dictionary_open(const char *base_filename,
+	const char *total_counts_filename);
+
+void mapped_dictionary_close(struct mapped_dictionary *self);
+
+size_t mapped_dictionary_num_words(const struct mapped_dictionary *self);
+
+const struct db_entry * mapped_dictionary_entries(const struct mapped_dictionary *self);
+
+const char * mapped_dictionary_text(const struct mapped_dictionary *self);
+
+long mapped_dictionary_find(const struct mapped_dictionary *self, const char *word);
+
+void mapped_dictionary_prefix(const struct mapped_dictionary *self, const char *prefix,
+	size_t *first, size_t *last);
+
+void mapped_dictionary_series(const struct mapped_dictionary *self, const char **words,
+	size_t num_words, unsigned int smoothing_window, double *series, long *indices);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAPPED_DICTIONARY_H_ */
@@ -0,0 +1,24 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/* A whole file mapped read-only in memory; empty files map to NULL */
+struct mapped_file {
+	const void *data;
+	size_t size;
+};
+
+int map_file(struct mapped_file *self, const char *filename);
+
+void unmap_file(struct mapped_file *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAPPED_FILE_H_ */
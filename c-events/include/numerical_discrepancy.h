@@ -5,15 +5,36 @@
 #include <cstring>
 #include "file.h"
 #include "generic_processor.h"
+#include "relevance_matrix.h"
+#include "screening.h"
+#include "summary_sink.h"
+
+typedef std::pair<size_t, size_t> max_segment;
+
+struct discrepancy_workspace {
+	std::vector<double> burstiness;
+	std::vector<double> sums, lesser_sums;
+	std::vector<max_segment> stack;
+	std::vector<size_t> segment_end;
+	std::vector< std::pair<size_t, size_t> > indices, pending;
+	std::vector< std::pair< std::pair<size_t, size_t>, double > > intervals;
+};
+
+void fit_discrepancy(const double *series, unsigned int smoothing_window,
+	std::vector< std::pair< std::pair<size_t, size_t>, double > > &intervals);
 
 void fit_discrepancy(const double *series, unsigned int smoothing_window,
+	discrepancy_workspace &workspace,
 	std::vector< std::pair< std::pair<size_t, size_t>, double > > &intervals);
 
+bool discrepancy_admissible(const series_statistics &stats);
+
 class numerical_discrepancy_processor : public generic_processor {
 
 public:
 
-	numerical_discrepancy_processor(double *series, const char *filename);
+	numerical_discrepancy_processor(double *series, series_screen &screen,
+		const char *filename, relevance_format format = RELEVANCE_CSV);
 
 	virtual ~numerical_discrepancy_processor();
 
@@ -21,11 +42,18 @@ public:
 
 	virtual void compute_summary(const char *word);
 
-	static numerical_discrepancy_processor * create(double *series, const char *filename);
+	void attach_index(event_index *index);
+
+	static numerical_discrepancy_processor * create(double *series, series_screen &screen,
+		const char *filename, relevance_format format = RELEVANCE_CSV);
 
 private:
 	double *series;
+	series_screen &screen;
+	discrepancy_workspace workspace;
 	excl_file efile;
+	relevance_matrix matrix;
+	summary_sink sink;
 
 };
 
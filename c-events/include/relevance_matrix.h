@@ -0,0 +1,69 @@
+#ifndef RELEVANCE_MATRIX_H_
+#define RELEVANCE_MATRIX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define RELEVANCE_MATRIX_MAGIC "HEVRELM"
+#define RELEVANCE_MATRIX_VERSION 1
+
+enum relevance_format {
+	RELEVANCE_CSV,
+	RELEVANCE_CSR,
+	RELEVANCE_DENSE
+};
+
+/*
+ * Binary relevance matrices start with this header, little-endian like the
+ * rest of the file, as matrix_io.py reads them; the C readers take the file
+ * as is, on the little-endian hosts the tools run on. A CSR matrix stores
+ * the int32 column indices, the uint8 values and the int64 row pointers at
+ * the given offsets, each section aligned to 8 bytes. A dense matrix stores
+ * num_rows * num_cols uint8 values at data_offset. The header is written
+ * with the first row, or when the matrix is finished without any, so a
+ * matrix without rows is still a valid file.
+ */
+struct relevance_matrix_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t format;
+	uint64_t num_rows;
+	uint64_t num_cols;
+	uint64_t nnz;
+	uint64_t indices_offset;
+	uint64_t data_offset;
+	uint64_t indptr_offset;
+};
+
+struct relevance_matrix {
+	FILE *f;
+	enum relevance_format format;
+	size_t num_cols;
+	uint64_t num_rows;
+	uint64_t nnz;
+	int started;
+	uint8_t *row;
+	int32_t *row_indices;
+	FILE *data;
+	int64_t *indptr;
+	size_t indptr_capacity;
+};
+
+const char * relevance_format_extension(enum relevance_format format);
+
+int init_relevance_matrix(struct relevance_matrix *self, FILE *f,
+	enum relevance_format format, size_t num_cols);
+
+int append_relevance_row(struct relevance_matrix *self, const int *counts);
+
+int finish_relevance_matrix(struct relevance_matrix *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RELEVANCE_MATRIX_H_ */
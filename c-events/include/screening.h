@@ -0,0 +1,57 @@
+#ifndef SCREENING_H_
+#define SCREENING_H_
+
+#include <cstdio>
+#include "series.h"
+
+enum screened_detector {
+	SCREEN_DOUBLE_CHANGE,
+	SCREEN_LINEAR_MODEL,
+	SCREEN_GAUSSIANS,
+	SCREEN_DISCREPANCY,
+	NUM_SCREENED_DETECTORS
+};
+
+/*
+ * Lower bounds below which a detector is skipped although it might have
+ * emitted an event, trading recall for speed. Zero keeps only the provable
+ * bounds, which never change the output.
+ */
+struct screening_thresholds {
+	double min_gaussian_burstiness;
+	double min_linear_model_burstiness;
+};
+
+/*
+ * First stage of the detector cascade: the statistics of the smoothed series
+ * are computed once per word and every expensive detector is asked, through
+ * the admissibility bound it declares, whether it could emit anything.
+ */
+class series_screen {
+
+public:
+
+	series_screen(const screening_thresholds &thresholds);
+
+	void set_thresholds(const screening_thresholds &thresholds);
+
+	void screen(const double *series, size_t inf, size_t sup);
+
+	void series_normalized();
+
+	bool admits(screened_detector detector);
+
+	const series_statistics & statistics() const;
+
+	void print_counters(FILE *f) const;
+
+private:
+	screening_thresholds thresholds;
+	series_statistics stats;
+	const double *series;
+	unsigned long long num_screened[NUM_SCREENED_DETECTORS];
+	unsigned long long num_skipped[NUM_SCREENED_DETECTORS];
+
+};
+
+#endif /* SCREENING_H_ */
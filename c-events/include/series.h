@@ -5,8 +5,24 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
+struct series_statistics {
+	double min_value, max_value;
+	double mean, variance;
+	double burstiness;
+	double max_ratio;
+};
+
 void smoothify_series(const double *in, double *out, unsigned int size, unsigned int smoothing_window);
 
+void average_series(const double *in, double *out, unsigned int size, unsigned int smoothing_window);
+
+void compute_series_statistics(const double *series, size_t inf, size_t sup,
+	struct series_statistics *stats);
+
+void normalize_series_statistics(struct series_statistics *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,62 @@
+#ifndef SERIES_DATABASE_H_
+#define SERIES_DATABASE_H_
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "mapped_dictionary.h"
+#include "relevance_matrix.h"
+
+/* A binary relevance matrix read in place from its mapping */
+struct relevance_view {
+	std::string name;
+	struct mapped_file file;
+	const struct relevance_matrix_header *header;
+	const int32_t *indices;
+	const uint8_t *data;
+	const int64_t *indptr;
+};
+
+/*
+ * The sorted dictionary and the binary relevance matrices, mapped once for
+ * answering many lookups. Decoded series are kept in a cache that drops the
+ * least recently used ones beyond cache_size words.
+ */
+class series_database {
+
+public:
+
+	series_database(size_t cache_size);
+
+	~series_database();
+
+	int open(const char *base_filename, const char *total_counts_filename);
+
+	int add_relevance(const char *name, const char *filename);
+
+	size_t num_words() const;
+
+	long find_word(const char *word, size_t length) const;
+
+	const std::vector<double> & frequencies(size_t index);
+
+	void smoothed_frequencies(size_t index, unsigned int smoothing_window,
+		std::vector<double> &series);
+
+	bool relevance_row(const std::string &name, size_t index, std::vector<int> &row) const;
+
+private:
+	typedef std::list<std::pair<size_t, std::vector<double> > > cache_list;
+
+	size_t cache_size;
+	bool opened;
+	struct mapped_dictionary dictionary;
+	std::vector<relevance_view> matrices;
+	cache_list cache;
+	std::map<size_t, cache_list::iterator> cached;
+
+};
+
+#endif /* SERIES_DATABASE_H_ */
@@ -0,0 +1,85 @@
+#ifndef SERIES_STORE_H_
+#define SERIES_STORE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dictionary_files.h"
+#include "mapped_file.h"
+
+#define SERIES_STORE_MAGIC "HEVSERS"
+#define SERIES_STORE_VERSION 2
+#define SERIES_STORE_ALIGNMENT 64
+
+/* log16 covers shares from 1e-12 to 100%, within 0.03% of their value */
+#define SERIES_LOG16_MIN 1e-12
+#define SERIES_LOG16_MAX 1e2
+
+enum series_encoding {
+	SERIES_FLOAT32,
+	SERIES_LOG16
+};
+
+/*
+ * The series of every word of a sorted dictionary, as table_to_series makes
+ * them and optionally smoothed by smoothify_series, stored next to its .main
+ * file with the .series extension in native byte order. Every word has a row
+ * of num_years values at row_stride bytes from the previous one, rows start
+ * aligned on cache lines. float32 rows hold the values; log16 rows hold 0 for
+ * zero and otherwise 1 + round((ln(value) - log_min) / log_step). The
+ * fingerprint is that of the dictionary files the store was built from.
+ */
+struct series_store_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t encoding;
+	uint32_t smoothed;
+	uint32_t smoothing_window;
+	uint32_t num_years;
+	uint32_t reserved;
+	uint64_t num_words;
+	uint64_t row_stride;
+	uint64_t rows_offset;
+	double log_min;
+	double log_step;
+	struct dictionary_fingerprint fingerprint;
+};
+
+/* A mapped store; log16 stores decode through a table of every code's value */
+struct series_store {
+	struct mapped_file file;
+	const struct series_store_header *header;
+	const unsigned char *rows;
+	double *log16_values;
+};
+
+void init_series_store_header(struct series_store_header *header, enum series_encoding encoding,
+	int smoothed, unsigned int smoothing_window, size_t num_years, size_t num_words);
+
+size_t series_store_size(const struct series_store_header *header);
+
+void encode_series_row(const struct series_store_header *header, const double *series,
+	void *row);
+
+int open_series_store(struct series_store *self, const char *filename);
+
+void close_series_store(struct series_store *self);
+
+void decode_series_row(const struct series_store *self, size_t index, double *series);
+
+const char * series_encoding_name(enum series_encoding encoding);
+
+int open_dictionary_series(struct series_store *self, const char *base_filename,
+	size_t num_words, unsigned int smoothing_window);
+
+void series_store_smoothed(const struct series_store *self, size_t index,
+	unsigned int smoothing_window, double *series, double *smooth_series);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SERIES_STORE_H_ */
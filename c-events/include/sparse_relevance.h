@@ -0,0 +1,36 @@
+#ifndef SPARSE_RELEVANCE_H_
+#define SPARSE_RELEVANCE_H_
+
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+/* A relevance matrix with one row per word and one column per year */
+struct sparse_relevance {
+	size_t num_rows;
+	size_t num_cols;
+	std::vector<uint64_t> indptr;
+	std::vector<uint32_t> indices;
+	std::vector<float> values;
+};
+
+struct sparse_vector {
+	std::vector<uint32_t> indices;
+	std::vector<float> values;
+};
+
+int read_sparse_relevance(const char *filename, sparse_relevance &matrix);
+
+void relevance_to_year_vectors(const sparse_relevance &matrix,
+	std::vector<sparse_vector> &years);
+
+float sparse_dot(const sparse_vector &x, const sparse_vector &y);
+
+void year_lengths(const sparse_relevance &matrix, std::vector<float> &lengths);
+
+void year_gram_matrix(const sparse_relevance &matrix, std::vector<float> &gram);
+
+void year_gram_matrix_blocked(const sparse_relevance &matrix, std::vector<float> &gram,
+	size_t block_size);
+
+#endif /* SPARSE_RELEVANCE_H_ */
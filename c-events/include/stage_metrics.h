@@ -0,0 +1,146 @@
+#ifndef STAGE_METRICS_H_
+#define STAGE_METRICS_H_
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define NUM_SLOWEST_WORDS 10
+#define NUM_LATENCY_BUCKETS 48
+
+enum pipeline_stage {
+	STAGE_READ_TABLE,
+	STAGE_SERIES,
+	STAGE_SCREENING,
+	STAGE_DOUBLE_CHANGE,
+	STAGE_LINEAR_MODEL,
+	STAGE_GAUSSIANS,
+	STAGE_DISCREPANCY,
+	STAGE_KLEINBERG,
+	NUM_PIPELINE_STAGES
+};
+
+#ifndef NO_STAGE_METRICS
+
+/*
+ * Where the time of a pass of process or relevance over the dictionary goes.
+ * Every word is timed in laps: end_stage charges the time since the previous
+ * mark to a stage, so a stage costs one read of the time stamp counter. The
+ * summaries and matrices are buffered, so their writes are charged to the
+ * stage which fills them. Along with the cumulative time of every stage come
+ * log2 histograms of the time per word and the slowest words with their
+ * breakdown. Build with NO_STAGE_METRICS to compile all of it out.
+ */
+class stage_metrics {
+
+public:
+
+	stage_metrics(size_t num_slowest = NUM_SLOWEST_WORDS);
+
+	void start(size_t num_words);
+
+	void begin_word()
+	{
+		for (size_t i = 0; i < NUM_PIPELINE_STAGES; i++)
+			word_ticks[i] = 0;
+		word_start = last_mark = read_ticks();
+	}
+
+	void end_stage(pipeline_stage stage)
+	{
+		const uint64_t now = read_ticks();
+		word_ticks[stage] += now - last_mark;
+		last_mark = now;
+	}
+
+	void end_word(const char *word);
+
+	void progress(size_t position);
+
+	void print(FILE *f) const;
+
+private:
+	struct slow_word {
+		uint64_t ticks;
+		std::string word;
+		uint64_t stage_ticks[NUM_PIPELINE_STAGES];
+		bool operator>(const slow_word &other) const { return ticks > other.ticks; }
+	};
+
+	static uint64_t read_ticks()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+	}
+
+	double seconds_per_tick() const;
+
+	size_t num_words;
+	size_t num_slowest;
+	size_t percent;
+	unsigned long long num_timed;
+	struct timespec start_time;
+	uint64_t start_ticks;
+	uint64_t word_start;
+	uint64_t last_mark;
+	uint64_t word_ticks[NUM_PIPELINE_STAGES];
+	uint64_t stage_ticks[NUM_PIPELINE_STAGES];
+	unsigned long long stage_histograms[NUM_PIPELINE_STAGES][NUM_LATENCY_BUCKETS];
+	unsigned long long word_histogram[NUM_LATENCY_BUCKETS];
+	std::vector<slow_word> slowest;
+
+};
+
+#else
+
+/* What is left of the metrics without them: the progress lines */
+class stage_metrics {
+
+public:
+
+	stage_metrics(size_t = NUM_SLOWEST_WORDS) : num_words(0), percent(0) { }
+
+	void start(size_t num_words)
+	{
+		this->num_words = num_words;
+		percent = 0;
+	}
+
+	void begin_word() { }
+
+	void end_stage(pipeline_stage) { }
+
+	void end_word(const char *) { }
+
+	void progress(size_t position)
+	{
+		const size_t new_percent = (100 * position) / num_words;
+		if (new_percent > percent) {
+			percent = new_percent;
+			if (percent % 4 == 0)
+				printf("%u%% done\n", (unsigned int) percent);
+		}
+	}
+
+	void print(FILE *) const { }
+
+private:
+	size_t num_words;
+	size_t percent;
+
+};
+
+#endif /* NO_STAGE_METRICS */
+
+#endif /* STAGE_METRICS_H_ */
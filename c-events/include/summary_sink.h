@@ -0,0 +1,68 @@
+#ifndef SUMMARY_SINK_H_
+#define SUMMARY_SINK_H_
+
+#include <vector>
+#include <cstdio>
+#include "event_index.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define SUMMARY_BUFFER_SIZE (1 << 20)
+
+/*
+ * Buffered writer of the "word\tyear\tscore" summary lines. Integers are
+ * formatted by hand and the buffer goes to the file in large chunks, so
+ * stdio is only entered once per megabyte. With a word file, every word is
+ * written there once as "id\tword" and the lines carry its id instead. The
+ * lines may also be compressed as a zstd stream when built with HAVE_ZSTD.
+ * An attached event index receives every event as well.
+ */
+class summary_sink {
+
+public:
+
+	summary_sink();
+
+	~summary_sink();
+
+	int open(FILE *f, FILE *word_file = NULL, bool compressed = false);
+
+	bool is_open() const;
+
+	void attach_index(event_index *index);
+
+	void begin_word(const char *word);
+
+	void append(unsigned int year, int score);
+
+	int close();
+
+private:
+	summary_sink(const summary_sink &);
+	summary_sink & operator=(const summary_sink &);
+
+	void reserve(size_t size);
+	void flush(bool end);
+
+	FILE *f;
+	FILE *word_file;
+	event_index *index;
+	std::vector<char> buffer;
+	size_t used;
+	const char *word;
+	size_t word_length;
+	bool word_written;
+	char word_id[24];
+	unsigned long next_word_id;
+	bool started;
+	bool failed;
+#ifdef HAVE_ZSTD
+	ZSTD_CCtx *cctx;
+	std::vector<char> compressed_buffer;
+#endif
+
+};
+
+#endif /* SUMMARY_SINK_H_ */
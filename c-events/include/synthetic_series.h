@@ -0,0 +1,21 @@
+#ifndef SYNTHETIC_SERIES_H_
+#define SYNTHETIC_SERIES_H_
+
+#include <cstdlib>
+
+void seed_synthetic(unsigned int seed);
+
+double uniform_sample();
+
+double pareto_sample(double scale, double shape);
+
+void heavy_tailed_series(double *series, size_t size, double shape);
+void bursty_relevance_row(int *counts, size_t size, size_t num_events);
+
+void flat_series(double *series, size_t size, double level);
+void spike_series(double *series, size_t size, double level);
+void gaussian_bump_series(double *series, size_t size, double level);
+void step_series(double *series, size_t size, double level);
+void multi_burst_series(double *series, size_t size, double level, size_t num_bursts);
+
+#endif /* SYNTHETIC_SERIES_H_ */
@@ -0,0 +1,116 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC "HEVTRCE"
+#define TRACE_VERSION 1
+#define TRACE_MAX_VALUES 10
+#define TRACE_BUFFER_SIZE 4096
+
+/* The levels, from the events a detector emits to every candidate it weighs */
+#define TRACE_LEVEL_NONE 0
+#define TRACE_LEVEL_EVENTS 1
+#define TRACE_LEVEL_CANDIDATES 2
+
+/* The categories, one per detector */
+#define TRACE_WORDS (1u << 0)
+#define TRACE_GAUSSIANS (1u << 1)
+#define TRACE_LINEAR_MODEL (1u << 2)
+#define TRACE_DISCREPANCY (1u << 3)
+#define TRACE_KLEINBERG (1u << 4)
+#define TRACE_DOUBLE_CHANGE (1u << 5)
+#define TRACE_ALL_CATEGORIES 0xffffffffu
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_NONE
+#endif
+
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES TRACE_ALL_CATEGORIES
+#endif
+
+enum trace_event {
+	TRACE_WORD,
+	TRACE_GAUSSIAN_CANDIDATE,
+	TRACE_GAUSSIAN_ACCEPTED,
+	TRACE_LINEAR_RANGE,
+	TRACE_DISCREPANCY_SEGMENT,
+	NUM_TRACE_EVENTS
+};
+
+/*
+ * A trace file starts with its header and holds fixed-size records in
+ * native byte order. A TRACE_WORD record carries the word the following
+ * records are about in place of its values, truncated and NUL-terminated.
+ */
+struct trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+};
+
+struct trace_record {
+	uint64_t sequence;
+	uint16_t category;
+	uint16_t event;
+	uint32_t num_values;
+	double values[TRACE_MAX_VALUES];
+};
+
+/*
+ * Tracing is decided at compile time: build with -DTRACE_LEVEL=1 or 2 and
+ * optionally -DTRACE_CATEGORIES set to the detectors of interest. Below the
+ * level or outside the categories, TRACE expands to nothing and its
+ * arguments are not evaluated, so the hot paths pay nothing. Otherwise every
+ * thread appends its records to a buffer of its own, which goes to
+ * trace-PID-N.bin when full and when the thread or the process ends;
+ * trace_dump prints them.
+ */
+#define TRACE_ENABLED(category, level) \
+	(TRACE_LEVEL >= (level) && (TRACE_CATEGORIES & (category)) != 0)
+
+#if TRACE_LEVEL > TRACE_LEVEL_NONE
+
+#define TRACE(category, level, event, ...) \
+	do { \
+		if (TRACE_ENABLED(category, level)) { \
+			const double trace_values_[] = { __VA_ARGS__ }; \
+			trace_record(category, event, trace_values_, \
+				sizeof(trace_values_) / sizeof(*trace_values_)); \
+		} \
+	} while (0)
+
+#define TRACE_BEGIN_WORD(word) \
+	do { \
+		if (TRACE_ENABLED(TRACE_WORDS, TRACE_LEVEL_EVENTS)) \
+			trace_word(word); \
+	} while (0)
+
+#else
+
+#define TRACE(category, level, event, ...) ((void) 0)
+
+#define TRACE_BEGIN_WORD(word) ((void) 0)
+
+#endif
+
+void trace_record(unsigned int category, enum trace_event event, const double *values,
+	size_t num_values);
+
+void trace_word(const char *word);
+
+void trace_flush(void);
+
+const char * trace_event_name(enum trace_event event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H_ */
@@ -25,6 +25,7 @@ char * concatenate(const char *left, const char *right);
 long get_file_size(FILE *f);
 long long get_file_size64(FILE *f);
 int file_exists(const char *filename);
+int make_directory(const char *path);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,27 @@
+#ifndef WORD_CLUSTERING_H_
+#define WORD_CLUSTERING_H_
+
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+#include "sparse_relevance.h"
+
+struct word_clustering_options {
+	/* Signatures have num_bands * rows_per_band MinHashes */
+	size_t num_bands;
+	size_t rows_per_band;
+	/* Words are linked when the cosine of their rows reaches this */
+	float min_similarity;
+	/* Each word of a bucket is checked against this many of the next ones */
+	size_t window;
+	size_t num_threads;
+};
+
+void default_word_clustering_options(word_clustering_options &options);
+
+void cluster_words(const sparse_relevance &matrix, const word_clustering_options &options,
+	std::vector<uint32_t> &clusters);
+
+int write_word_clusters(FILE *f, const std::vector<uint32_t> &clusters);
+
+#endif /* WORD_CLUSTERING_H_ */
@@ -0,0 +1,60 @@
+#ifndef WORD_INDEX_H_
+#define WORD_INDEX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include "dictionary_files.h"
+#include "mapped_file.h"
+
+#define WORD_INDEX_MAGIC "HEVWIDX"
+#define WORD_INDEX_VERSION 2
+
+/*
+ * A minimal perfect hash of the words of a dictionary, stored next to its
+ * .main file with the .index extension, in native byte order. Every word
+ * hashes to a bucket whose displacement sends it to its own slot, and the
+ * slots hold the word indexes. A displacement with the high bit set is a
+ * bucket of one word placed directly in the slot of the low bits. Strings
+ * which are not in the dictionary land on some word too, so the callers
+ * compare against it. The fingerprint is that of the dictionary files the
+ * index was built from.
+ */
+struct word_index_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t seed;
+	uint64_t num_words;
+	uint64_t num_buckets;
+	uint64_t displacements_offset;
+	uint64_t slots_offset;
+	struct dictionary_fingerprint fingerprint;
+};
+
+struct word_index {
+	struct mapped_file file;
+	const struct word_index_header *header;
+	const uint32_t *displacements;
+	const uint32_t *slots;
+};
+
+int write_word_index(FILE *f, const char **words, const size_t *lengths, size_t num_words,
+	const struct dictionary_fingerprint *fingerprint);
+
+int open_word_index(struct word_index *self, const char *filename);
+
+void close_word_index(struct word_index *self);
+
+int open_dictionary_index(struct word_index *self, const char *base_filename,
+	size_t num_words);
+
+size_t word_index_candidate(const struct word_index *self, const char *word, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORD_INDEX_H_ */
@@ -0,0 +1,61 @@
+#ifndef WORD_SELECTION_H_
+#define WORD_SELECTION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "dictionary_reader.h"
+
+enum pos_tag_filter {
+	POS_TAGS_INCLUDE,
+	POS_TAGS_EXCLUDE,
+	POS_TAGS_ONLY
+};
+
+/*
+ * The words of a targeted run: those listed in a file (one per line), those
+ * matching an extended regular expression, those starting with a prefix and
+ * those whose total match count is within bounds. Every criterion given must
+ * hold; a selection without any criterion is the whole dictionary.
+ *
+ * The criteria on the peak year, the first and last years, the number of
+ * active years, the maximum frequency, the variance and the part of speech
+ * tag are checked against the .stats of the dictionary, as is the ranking
+ * which keeps only the top_bursty words of highest burstiness, so none of
+ * them reads a table.
+ */
+struct word_selection {
+	const char *words_filename;
+	const char *pattern;
+	const char *prefix;
+	uint64_t min_match_count;
+	uint64_t max_match_count;
+	unsigned int min_peak_year;
+	unsigned int max_peak_year;
+	unsigned int max_first_year;
+	unsigned int min_last_year;
+	unsigned int min_active_years;
+	double min_max_frequency;
+	double min_variance;
+	enum pos_tag_filter pos_tags;
+	size_t top_bursty;
+};
+
+void init_word_selection(struct word_selection *self);
+
+int parse_word_selection(struct word_selection *self, int argc, char **argv);
+
+int is_word_selection_empty(const struct word_selection *self);
+
+int uses_word_stats(const struct word_selection *self);
+
+int select_words(const struct dictionary_reader *dict, const struct word_selection *self,
+	size_t **indices, size_t *num_indices);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORD_SELECTION_H_ */
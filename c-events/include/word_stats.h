@@ -0,0 +1,75 @@
+#ifndef WORD_STATS_H_
+#define WORD_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "dictionary_files.h"
+#include "dictionary_types.h"
+#include "mapped_file.h"
+
+#define WORD_STATS_MAGIC "HEVWSTS"
+#define WORD_STATS_VERSION 2
+
+/* The word carries a part of speech tag, as in "run_VERB" */
+#define WORD_STATS_POS_TAGGED (1u << 0)
+
+/*
+ * The statistics of every word of a sorted dictionary, stored next to its
+ * .main file with the .stats extension in native byte order: the header,
+ * then one record per word in the order of the .main file. Frequencies are
+ * the values of table_to_series. The mean, the variance and the burstiness
+ * (as compute_series_statistics defines it) cover the years from first_year
+ * to last_year; active_years counts those with a match. The fingerprint is
+ * that of the dictionary files the statistics were computed from.
+ */
+struct word_stats_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t num_words;
+	struct dictionary_fingerprint fingerprint;
+};
+
+struct word_stats {
+	uint16_t first_year;
+	uint16_t last_year;
+	uint16_t peak_year;
+	uint16_t active_years;
+	uint32_t flags;
+	float max_frequency;
+	float mean_frequency;
+	float variance;
+	float burstiness;
+	uint32_t reserved;
+};
+
+struct word_stats_file {
+	struct mapped_file file;
+	const struct word_stats_header *header;
+	const struct word_stats *entries;
+};
+
+void compute_word_stats(const struct time_entry *table, size_t table_size,
+	const struct total_counts_entry *frequencies, const char *word, size_t word_length,
+	struct word_stats *stats);
+
+int write_word_stats(FILE *f, const struct word_stats *stats, size_t num_words,
+	const struct dictionary_fingerprint *fingerprint);
+
+int open_word_stats(struct word_stats_file *self, const char *filename);
+
+void close_word_stats(struct word_stats_file *self);
+
+int open_dictionary_stats(struct word_stats_file *self, const char *base_filename,
+	size_t num_words);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORD_STATS_H_ */
@@ -1,4 +1,6 @@
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include "dictionary_files.h"
 #include "util.h"
 
@@ -66,3 +68,45 @@ void destroy_dictfiles(struct dictionary_files *files)
 	fclose(files->word_file);
 	fclose(files->main_file);
 }
+
+static int stat_file(const char *base_filename, const char *extension, uint64_t *size,
+	int64_t *mtime)
+{
+	char *filename = concatenate(base_filename, extension);
+	struct stat st;
+	int err = 1;
+
+	if (filename == NULL)
+		return 1;
+	if (stat(filename, &st) == 0) {
+		*size = (uint64_t) st.st_size;
+#ifdef _WIN32
+		*mtime = (int64_t) st.st_mtime * 1000000000;
+#else
+		*mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+		err = 0;
+	}
+	free(filename);
+	return err;
+}
+
+/* Fingerprints the files of the dictionary as they are on disk, once written and closed */
+int fingerprint_dictionary(const char *base_filename, struct dictionary_fingerprint *fingerprint)
+{
+	memset(fingerprint, 0, sizeof(*fingerprint));
+	if (stat_file(base_filename, ".main", &fingerprint->main_size, &fingerprint->main_mtime) != 0 ||
+			stat_file(base_filename, ".words", &fingerprint->word_size,
+				&fingerprint->word_mtime) != 0 ||
+			stat_file(base_filename, ".time", &fingerprint->time_size,
+				&fingerprint->time_mtime) != 0)
+		return 1;
+	return 0;
+}
+
+int same_dictionary(const struct dictionary_fingerprint *a, const struct dictionary_fingerprint *b)
+{
+	return a->main_size == b->main_size && a->word_size == b->word_size &&
+		a->time_size == b->time_size && a->main_mtime == b->main_mtime &&
+		a->word_mtime == b->word_mtime && a->time_mtime == b->time_mtime;
+}
@@ -4,10 +4,6 @@
 #include "dictionary_types.h"
 #include "util.h"
 
-#define BUFFER_SIZE 11000
-
-static int load_frequencies(struct total_counts_entry *frequencies,
-	const char *filename);
 static int load_database(struct dictionary_reader *self);
 static int load_words(struct dictionary_reader *self, size_t word_file_size);
 static void free_words(char **words, size_t num_words);
@@ -60,6 +56,9 @@ int init_dictreader(struct dictionary_reader *dict, const char *base_filename)
 	if (err != 0)
 		goto out_database;
 
+	dict->has_index = open_dictionary_index(&dict->index, base_filename, dict->num_words) == 0;
+	dict->has_stats = open_dictionary_stats(&dict->stats, base_filename, dict->num_words) == 0;
+
 out:
 	return err;
 
@@ -72,11 +71,43 @@ out_files:
 
 void destroy_dictreader(struct dictionary_reader *dict)
 {
+	if (dict->has_index)
+		close_word_index(&dict->index);
+	if (dict->has_stats)
+		close_word_stats(&dict->stats);
 	free_words(dict->words, dict->num_words);
 	free(dict->database);
 	destroy_dictfiles(&dict->files);
 }
 
+static int string_compare(const void *a, const void *b)
+{
+	const char *const *x = a;
+	const char *const *y = b;
+
+	return strcmp(*x, *y);
+}
+
+/*
+ * The index of the word in a dictionary sorted by sorter, or -1. The .index
+ * written with it makes that a single probe, instead of a bisection.
+ */
+long find_word(const struct dictionary_reader *dict, const char *word)
+{
+	char **p;
+	size_t index;
+
+	if (dict->has_index) {
+		index = word_index_candidate(&dict->index, word, strlen(word));
+		if (index < dict->num_words && strcmp(dict->words[index], word) == 0)
+			return (long) index;
+		return -1;
+	}
+
+	p = bsearch(&word, dict->words, dict->num_words, sizeof(*dict->words), string_compare);
+	return p != NULL ? (long) (p - dict->words) : -1;
+}
+
 int read_table(const struct dictionary_reader *dict, size_t index,
 	struct time_entry *table, size_t *table_size)
 {
@@ -199,7 +230,7 @@ unsigned int match_total_counts_feature(const struct total_counts_entry *entry)
 	return (unsigned int) (match_count / 1000);
 }
 
-static int load_frequencies(struct total_counts_entry *frequencies,
+int load_frequencies(struct total_counts_entry *frequencies,
 	const char *filename)
 {
 	FILE *f;
@@ -208,7 +239,8 @@ static int load_frequencies(struct total_counts_entry *frequencies,
 	int year, pos;
 	int page_count, volume_count;
 	int err = 0;
-	char line[BUFFER_SIZE];
+	char *line = NULL;
+	size_t capacity = 0;
 
 	f = fopen(filename, "rt");
 	if (f == NULL) {
@@ -217,7 +249,8 @@ static int load_frequencies(struct total_counts_entry *frequencies,
 		goto out;
 	}
 
-	if (fgets(line, sizeof(line), f) == NULL) {
+	/* The whole file is one line, which grows with the counts */
+	if (getline(&line, &capacity, f) < 0) {
 		fprintf(stderr, "Could not read line from: %s\n", filename);
 		err = 1;
 		goto out_file;
@@ -241,6 +274,7 @@ static int load_frequencies(struct total_counts_entry *frequencies,
 	}
 
 out_file:
+	free(line);
 	fclose(f);
 out:
 	return err;
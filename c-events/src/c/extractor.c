@@ -0,0 +1,285 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dictionary_reader.h"
+#include "dictionary_types.h"
+#include "util.h"
+#include "word_index.h"
+#include "word_selection.h"
+#include "word_stats.h"
+
+#define HOT_DIRECTORY "data/hot"
+#define HOT_BASE_FILENAME HOT_DIRECTORY "/googlebooks-eng-all-1gram-20120701-database"
+
+struct year_window {
+	unsigned int from, to;
+	int trimmed;
+};
+
+static int compare_indices(const void *a, const void *b)
+{
+	const size_t *x = a;
+	const size_t *y = b;
+
+	return *x < *y ? -1 : (*x > *y ? 1 : 0);
+}
+
+/* The words process summarizes without options: frequent, without a part of speech */
+static int select_default_words(const struct dictionary_reader *dict, size_t **indices,
+	size_t *num_indices)
+{
+	size_t i;
+
+	*num_indices = 0;
+	*indices = malloc(dict->num_words * sizeof(**indices) + 1);
+	if (*indices == NULL)
+		return 1;
+	for (i = 0; i < dict->num_words; i++) {
+		if (strchr(dict->words[i], '_') != NULL)
+			continue;
+		if (dict->database[i].total_match_count < (1 << 18))
+			continue;
+		(*indices)[(*num_indices)++] = i;
+	}
+	return 0;
+}
+
+/* Keeps the entries of the window in place, with the totals of what is kept */
+static size_t trim_table(struct time_entry *table, size_t table_size,
+	const struct year_window *window, struct db_entry *entry)
+{
+	size_t i, num_kept = 0;
+
+	if (!window->trimmed)
+		return table_size;
+
+	entry->total_match_count = 0;
+	entry->total_volume_count = 0;
+	for (i = 0; i < table_size; i++) {
+		if (table[i].year < window->from || table[i].year > window->to)
+			continue;
+		entry->total_match_count += table[i].match_count;
+		entry->total_volume_count += table[i].volume_count;
+		table[num_kept++] = table[i];
+	}
+	return num_kept;
+}
+
+/* Writes the .index and .stats of the output, whose dictionary files must be closed */
+static int write_sidecars(const char *base_filename, const char **words, const size_t *lengths,
+	const struct word_stats *stats, size_t num_words)
+{
+	char *index_filename = concatenate(base_filename, ".index");
+	char *stats_filename = concatenate(base_filename, ".stats");
+	struct dictionary_fingerprint fingerprint;
+	FILE *f;
+	int err = 1;
+
+	if (index_filename == NULL || stats_filename == NULL)
+		goto out;
+	if (fingerprint_dictionary(base_filename, &fingerprint) != 0) {
+		fprintf(stderr, "Could not fingerprint the dictionary: %s\n", base_filename);
+		goto out;
+	}
+
+	f = fopen(index_filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open: %s\n", index_filename);
+		goto out;
+	}
+	err = write_word_index(f, words, lengths, num_words, &fingerprint);
+	if (fclose(f) != 0)
+		err = 1;
+	if (err != 0)
+		goto out;
+
+	f = fopen(stats_filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open: %s\n", stats_filename);
+		err = 1;
+		goto out;
+	}
+	err = write_word_stats(f, stats, num_words, &fingerprint);
+	if (fclose(f) != 0)
+		err = 1;
+
+out:
+	free(stats_filename);
+	free(index_filename);
+	return err;
+}
+
+/* Removes the series store of a previous extraction, which series_builder rebuilds */
+static int remove_series_store(const char *base_filename)
+{
+	char *filename = concatenate(base_filename, ".series");
+	int err = 0;
+
+	if (filename == NULL)
+		return 1;
+	if (file_exists(filename) && remove(filename) != 0) {
+		fprintf(stderr, "Could not remove the stale series store: %s\n", filename);
+		err = 1;
+	}
+	free(filename);
+	return err;
+}
+
+/*
+ * Writes the selected words of a sorted dictionary, in the same order and
+ * format, as a dictionary of their own with contiguous tables restricted to
+ * the window, along with its .index and .stats. Words without a match in
+ * the window are left out, and the .series of a previous extraction is
+ * removed.
+ */
+int extract_dictionary(const char *input_filename, const char *output_filename,
+	const struct word_selection *selection, const struct year_window *window)
+{
+	struct time_entry table[MAX_YEARS];
+	struct dictionary_reader dict;
+	struct dictionary_files out_files;
+	struct db_entry entry;
+	struct word_stats *stats = NULL;
+	const char **words = NULL;
+	size_t *lengths = NULL;
+	size_t *selected = NULL;
+	size_t num_selected, num_written = 0, i, index, tlength, wlength;
+	uint64_t time_size = 0;
+	uint32_t wr_toffset = 0;
+	uint32_t wr_woffset = 0;
+	int err;
+
+	err = init_dictreader(&dict, input_filename);
+	if (err != 0) {
+		fprintf(stderr, "Could not init the dictionary reader.\n");
+		goto out;
+	}
+
+	if (is_word_selection_empty(selection)) {
+		err = select_default_words(&dict, &selected, &num_selected);
+	} else {
+		err = select_words(&dict, selection, &selected, &num_selected);
+		/* The output stays sorted, which find_word relies on */
+		if (err == 0)
+			qsort(selected, num_selected, sizeof(*selected), compare_indices);
+	}
+	if (err != 0)
+		goto out_reader;
+
+	err = 1;
+	stats = malloc(num_selected * sizeof(*stats) + 1);
+	words = malloc(num_selected * sizeof(*words) + 1);
+	lengths = malloc(num_selected * sizeof(*lengths) + 1);
+	if (stats == NULL || words == NULL || lengths == NULL)
+		goto out_reader;
+
+	if (remove_series_store(output_filename) != 0)
+		goto out_reader;
+	err = init_dictfiles(&out_files, output_filename, "wb");
+	if (err != 0) {
+		fprintf(stderr, "Could not init the output files.\n");
+		goto out_reader;
+	}
+
+	for (i = 0; i < num_selected; i++) {
+		index = selected[i];
+		err = read_table(&dict, index, table, &tlength);
+		if (err != 0)
+			goto out_files;
+
+		entry = dict.database[index];
+		tlength = trim_table(table, tlength, window, &entry);
+		if (tlength == 0)
+			continue;
+
+		wlength = strlen(dict.words[index]);
+		entry.word_offset = wr_woffset;
+		entry.time_offset = wr_toffset;
+		entry.time_length = (uint16_t) tlength;
+		if (fwrite(&entry, sizeof(entry), 1, out_files.main_file) != 1 ||
+				fwrite(dict.words[index], 1, wlength, out_files.word_file) != wlength ||
+				fwrite(table, sizeof(*table), tlength, out_files.time_file) != tlength) {
+			fprintf(stderr, "Could not write the %luth word.\n", (unsigned long) num_written);
+			err = 1;
+			goto out_files;
+		}
+
+		words[num_written] = dict.words[index];
+		lengths[num_written] = wlength;
+		compute_word_stats(table, tlength, dict.frequencies, dict.words[index], wlength,
+			&stats[num_written]);
+		num_written++;
+		wr_toffset += (uint32_t) (tlength * sizeof(*table));
+		wr_woffset += (uint32_t) wlength;
+		time_size += tlength * sizeof(*table);
+	}
+
+out_files:
+	destroy_dictfiles(&out_files);
+	if (err == 0) {
+		err = write_sidecars(output_filename, words, lengths, stats, num_written);
+		if (err != 0)
+			fprintf(stderr, "Could not write the index and statistics of: %s\n", output_filename);
+		else
+			printf("Extracted %lu of %lu words, %.1f of %.1f MB of tables, in %s\n",
+				(unsigned long) num_written, (unsigned long) dict.num_words,
+				(double) time_size / 1e6, (double) dict.time_file_size / 1e6, output_filename);
+	}
+out_reader:
+	free(lengths);
+	free(words);
+	free(stats);
+	free(selected);
+	destroy_dictreader(&dict);
+out:
+	return err;
+}
+
+/*
+ * Usage: extractor [--input BASE] [--output BASE] [--from YEAR] [--to YEAR]
+ *	[--words FILE] [--regex PATTERN] [--prefix PREFIX] [--min-count N] ...
+ * Extracts the selected words of
+ * data/sort/googlebooks-eng-all-1gram-20120701-database by default into
+ * data/hot, or the words process summarizes without options. With --from and
+ * --to, tables only keep those years and the totals are recounted over them.
+ * process --dictionary BASE then reads the extracted dictionary.
+ */
+int main(int argc, char **argv)
+{
+	const char *input_filename = "data/sort/googlebooks-eng-all-1gram-20120701-database";
+	const char *output_filename = HOT_BASE_FILENAME;
+	struct word_selection selection;
+	struct year_window window = { MIN_YEAR, MIN_YEAR + MAX_YEARS - 1, 0 };
+	char **selection_args;
+	int num_selection_args = 1;
+	int i, err;
+
+	selection_args = malloc((size_t) (argc + 1) * sizeof(*selection_args));
+	if (selection_args == NULL)
+		return EXIT_FAILURE;
+	selection_args[0] = argv[0];
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+			input_filename = argv[++i];
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output_filename = argv[++i];
+		} else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+			window.from = (unsigned int) strtoul(argv[++i], NULL, 10);
+			window.trimmed = 1;
+		} else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+			window.to = (unsigned int) strtoul(argv[++i], NULL, 10);
+			window.trimmed = 1;
+		} else {
+			selection_args[num_selection_args++] = argv[i];
+		}
+	}
+
+	init_word_selection(&selection);
+	err = parse_word_selection(&selection, num_selection_args, selection_args);
+	if (err == 0 && strcmp(output_filename, HOT_BASE_FILENAME) == 0)
+		make_directory(HOT_DIRECTORY);
+	if (err == 0)
+		err = extract_dictionary(input_filename, output_filename, &selection, &window);
+
+	free(selection_args);
+	return err;
+}
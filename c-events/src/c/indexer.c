@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mapped_dictionary.h"
+#include "util.h"
+#include "word_index.h"
+#include "word_stats.h"
+
+/* Writes the statistics of every word, from the tables of the mapped time file */
+static int write_dictionary_stats(const struct mapped_dictionary *dict, const char *base_filename)
+{
+	const struct db_entry *entry;
+	const struct time_entry *table;
+	struct dictionary_fingerprint fingerprint;
+	struct word_stats *stats;
+	char *filename;
+	size_t i;
+	FILE *f;
+	int err = 1;
+
+	stats = malloc(dict->num_words * sizeof(*stats) + 1);
+	filename = concatenate(base_filename, ".stats");
+	if (stats == NULL || filename == NULL)
+		goto out;
+	for (i = 0; i < dict->num_words; i++) {
+		entry = &dict->database[i];
+		table = (const struct time_entry *) ((const char *) dict->time_file.data + entry->time_offset);
+		compute_word_stats(table, entry->time_length, dict->frequencies,
+			(const char *) dict->word_file.data + entry->word_offset, entry->word_length, &stats[i]);
+	}
+
+	if (fingerprint_dictionary(base_filename, &fingerprint) != 0) {
+		fprintf(stderr, "Could not fingerprint the dictionary: %s\n", base_filename);
+		goto out;
+	}
+
+	f = fopen(filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open: %s\n", filename);
+		goto out;
+	}
+	err = write_word_stats(f, stats, dict->num_words, &fingerprint);
+	if (fclose(f) != 0)
+		err = 1;
+	if (err == 0)
+		printf("Wrote the statistics of %lu words in %s\n", (unsigned long) dict->num_words,
+			filename);
+
+out:
+	free(filename);
+	free(stats);
+	return err;
+}
+
+/*
+ * Writes the perfect hash and the word statistics of a dictionary which
+ * sorter already produced.
+ */
+int index_dictionary(const char *base_filename, const char *total_counts_filename)
+{
+	struct mapped_dictionary dict;
+	struct dictionary_fingerprint fingerprint;
+	const struct db_entry *entry;
+	const char **words = NULL;
+	size_t *lengths = NULL;
+	char *index_filename = NULL;
+	size_t i;
+	FILE *f;
+	int err;
+
+	err = init_mapped_dictionary(&dict, base_filename, total_counts_filename);
+	if (err != 0) {
+		fprintf(stderr, "Could not map the dictionary.\n");
+		goto out;
+	}
+
+	err = 1;
+	words = malloc(dict.num_words * sizeof(*words) + 1);
+	lengths = malloc(dict.num_words * sizeof(*lengths) + 1);
+	index_filename = concatenate(base_filename, ".index");
+	if (words == NULL || lengths == NULL || index_filename == NULL)
+		goto out_dict;
+	for (i = 0; i < dict.num_words; i++) {
+		entry = &dict.database[i];
+		words[i] = (const char *) dict.word_file.data + entry->word_offset;
+		lengths[i] = entry->word_length;
+	}
+	if (fingerprint_dictionary(base_filename, &fingerprint) != 0) {
+		fprintf(stderr, "Could not fingerprint the dictionary: %s\n", base_filename);
+		goto out_dict;
+	}
+
+	/* The old index is rewritten in place, so it must not stay mapped */
+	if (dict.has_index) {
+		close_word_index(&dict.index);
+		dict.has_index = 0;
+	}
+
+	f = fopen(index_filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open: %s\n", index_filename);
+		goto out_dict;
+	}
+	err = write_word_index(f, words, lengths, dict.num_words, &fingerprint);
+	if (fclose(f) != 0)
+		err = 1;
+	if (err == 0)
+		printf("Indexed %lu words in %s\n", (unsigned long) dict.num_words, index_filename);
+	if (err == 0)
+		err = write_dictionary_stats(&dict, base_filename);
+
+out_dict:
+	free(index_filename);
+	free(lengths);
+	free(words);
+	destroy_mapped_dictionary(&dict);
+out:
+	return err;
+}
+
+/*
+ * Usage: indexer [base_filename]
+ * Builds the .index and the .stats of
+ * data/sort/googlebooks-eng-all-1gram-20120701-database by default, for
+ * dictionaries sorted before sorter wrote them.
+ */
+int main(int argc, char **argv)
+{
+	const char *base_filename = argc > 1 ? argv[1] :
+		"data/sort/googlebooks-eng-all-1gram-20120701-database";
+
+	return index_dictionary(base_filename, "data/googlebooks-eng-all-totalcounts-20120701.txt");
+}
@@ -88,17 +88,37 @@ void normalize_standard_score(double *data, size_t num_elems)
 		data[i] = (data[i] - mean) / sigma;
 }
 
-void normalize_generate_ranges(struct static_array *ranges,
-	const gsl_multimin_fdfminimizer_type *T,
-	gsl_multimin_function_fdf *fdf)
+/* Standardizes the series the model is fitted on, in place */
+void normalize_training_data(gsl_multimin_function_fdf *fdf)
 {
 	const struct static_range *training_data;
 
 	training_data = fdf->params;
 	normalize_standard_score(training_data->array, training_data->size);
+}
+
+void normalize_generate_ranges(struct static_array *ranges,
+	const gsl_multimin_fdfminimizer_type *T,
+	gsl_multimin_function_fdf *fdf)
+{
+	normalize_training_data(fdf);
 	generate_ranges(ranges, T, fdf);
 }
 
+/*
+ * A flat series standardizes to NaNs, which never pass the score threshold.
+ * Everything else is admissible unless a recall-trading threshold is set.
+ */
+int linear_model_admissible(const struct series_statistics *stats,
+	double min_burstiness)
+{
+	if (!(stats->max_value > stats->min_value))
+		return 0;
+	if (min_burstiness > 0.0 && !(stats->burstiness >= min_burstiness))
+		return 0;
+	return 1;
+}
+
 static double range_get(const struct static_range *self, size_t index)
 {
 	double value;
@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mapped_dictionary.h"
+#include "series.h"
+#include "util.h"
+
+static int map_dictionary_file(struct mapped_file *file, const char *base_filename,
+	const char *extension)
+{
+	char *filename;
+	int err;
+
+	filename = concatenate(base_filename, extension);
+	if (filename == NULL)
+		return 1;
+	err = map_file(file, filename);
+	if (err != 0)
+		fprintf(stderr, "Could not map: %s\n", filename);
+	free(filename);
+	return err;
+}
+
+int init_mapped_dictionary(struct mapped_dictionary *self, const char *base_filename,
+	const char *total_counts_filename)
+{
+	const struct db_entry *entry;
+	size_t i;
+	int err = 0;
+
+	memset(self, 0, sizeof(*self));
+
+	err = load_frequencies(self->frequencies, total_counts_filename);
+	if (err != 0)
+		goto out;
+
+	err = map_dictionary_file(&self->main_file, base_filename, ".main");
+	if (err != 0)
+		goto out;
+
+	err = map_dictionary_file(&self->word_file, base_filename, ".words");
+	if (err != 0)
+		goto out_main_file;
+
+	err = map_dictionary_file(&self->time_file, base_filename, ".time");
+	if (err != 0)
+		goto out_word_file;
+
+	self->database = self->main_file.data;
+	self->num_words = self->main_file.size / sizeof(*self->database);
+	for (i = 0; i < self->num_words; i++) {
+		entry = &self->database[i];
+		if ((size_t) entry->word_offset + entry->word_length > self->word_file.size ||
+				(size_t) entry->time_offset + entry->time_length * sizeof(struct time_entry) >
+				self->time_file.size) {
+			fprintf(stderr, "The %luth entry is out of bounds\n", (unsigned long) i);
+			err = 1;
+			goto out_time_file;
+		}
+	}
+
+	/* Without an index, or with a stale one, lookups fall back to bisection */
+	self->has_index = open_dictionary_index(&self->index, base_filename, self->num_words) == 0;
+
+out:
+	return err;
+
+out_time_file:
+	unmap_file(&self->time_file);
+out_word_file:
+	unmap_file(&self->word_file);
+out_main_file:
+	unmap_file(&self->main_file);
+	self->database = NULL;
+	self->num_words = 0;
+	goto out;
+}
+
+void destroy_mapped_dictionary(struct mapped_dictionary *self)
+{
+	if (self->has_index)
+		close_word_index(&self->index);
+	self->has_index = 0;
+	unmap_file(&self->time_file);
+	unmap_file(&self->word_file);
+	unmap_file(&self->main_file);
+	self->database = NULL;
+	self->num_words = 0;
+}
+
+/*
+ * Compares the word at index with the first length bytes of key, as strcmp
+ * would when whole is set, and otherwise as a prefix: every word which
+ * starts with the key compares equal to it.
+ */
+static int compare_word(const struct mapped_dictionary *self, size_t index, const char *key,
+	size_t length, int whole)
+{
+	const struct db_entry *entry = &self->database[index];
+	const char *word = (const char *) self->word_file.data + entry->word_offset;
+	int cmp;
+
+	cmp = memcmp(word, key, entry->word_length < length ? entry->word_length : length);
+	if (cmp != 0)
+		return cmp;
+	if (entry->word_length < length)
+		return -1;
+	return whole && entry->word_length > length ? 1 : 0;
+}
+
+/* The first word for which the comparison is at least (or above) zero */
+static size_t bisect_words(const struct mapped_dictionary *self, const char *key, size_t length,
+	int whole, int above)
+{
+	size_t low = 0, high = self->num_words, middle;
+	int cmp;
+
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		cmp = compare_word(self, middle, key, length, whole);
+		if (cmp < 0 || (above && cmp == 0))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+/*
+ * Looks the word up in the perfect hash when there is one, and otherwise
+ * bisects the words, which sorter ordered as strcmp does.
+ */
+long find_mapped_word(const struct mapped_dictionary *self, const char *word, size_t length)
+{
+	size_t index;
+
+	if (self->has_index)
+		index = word_index_candidate(&self->index, word, length);
+	else
+		index = bisect_words(self, word, length, 1, 0);
+
+	if (index < self->num_words && compare_word(self, index, word, length, 1) == 0)
+		return (long) index;
+	return -1;
+}
+
+/* The words [first, last) which start with the prefix, in order */
+void find_mapped_prefix(const struct mapped_dictionary *self, const char *prefix, size_t length,
+	size_t *first, size_t *last)
+{
+	*first = bisect_words(self, prefix, length, 0, 0);
+	*last = bisect_words(self, prefix, length, 0, 1);
+}
+
+/*
+ * The share of each year's matches that went to the word, as dictionary.py
+ * computes it; years outside the dictionary range are ignored.
+ */
+void mapped_word_frequencies(const struct mapped_dictionary *self, size_t index, double *series)
+{
+	const struct db_entry *entry = &self->database[index];
+	const struct time_entry *table;
+	uint64_t year_match_count;
+	size_t j, pos;
+
+	memset(series, 0, MAX_YEARS * sizeof(*series));
+	table = (const struct time_entry *) ((const char *) self->time_file.data + entry->time_offset);
+	for (j = 0; j < entry->time_length; j++) {
+		if (table[j].year < MIN_YEAR || table[j].year >= MIN_YEAR + MAX_YEARS)
+			continue;
+		pos = (size_t) (table[j].year - MIN_YEAR);
+		year_match_count = self->frequencies[pos].match_count;
+		if (year_match_count != 0)
+			series[pos] = (double) table[j].match_count / (double) year_match_count;
+	}
+}
+
+struct mapped_dictionary * mapped_dictionary_open(const char *base_filename,
+	const char *total_counts_filename)
+{
+	struct mapped_dictionary *self;
+
+	self = malloc(sizeof(*self));
+	if (self == NULL)
+		return NULL;
+	if (init_mapped_dictionary(self, base_filename, total_counts_filename) != 0) {
+		free(self);
+		return NULL;
+	}
+	return self;
+}
+
+void mapped_dictionary_close(struct mapped_dictionary *self)
+{
+	if (self == NULL)
+		return;
+	destroy_mapped_dictionary(self);
+	free(self);
+}
+
+size_t mapped_dictionary_num_words(const struct mapped_dictionary *self)
+{
+	return self->num_words;
+}
+
+const struct db_entry * mapped_dictionary_entries(const struct mapped_dictionary *self)
+{
+	return self->database;
+}
+
+const char * mapped_dictionary_text(const struct mapped_dictionary *self)
+{
+	return self->word_file.data;
+}
+
+long mapped_dictionary_find(const struct mapped_dictionary *self, const char *word)
+{
+	return find_mapped_word(self, word, strlen(word));
+}
+
+void mapped_dictionary_prefix(const struct mapped_dictionary *self, const char *prefix,
+	size_t *first, size_t *last)
+{
+	find_mapped_prefix(self, prefix, strlen(prefix), first, last);
+}
+
+/*
+ * Fills one row of MAX_YEARS values per word, averaged over smoothing_window
+ * years on each side, and the index of each word. Unknown words get -1 and a
+ * row of zeros.
+ */
+void mapped_dictionary_series(const struct mapped_dictionary *self, const char **words,
+	size_t num_words, unsigned int smoothing_window, double *series, long *indices)
+{
+	double frequencies[MAX_YEARS];
+	double *row;
+	size_t i;
+
+	for (i = 0; i < num_words; i++) {
+		row = series + i * MAX_YEARS;
+		indices[i] = mapped_dictionary_find(self, words[i]);
+		if (indices[i] < 0) {
+			memset(row, 0, MAX_YEARS * sizeof(*row));
+			continue;
+		}
+		mapped_word_frequencies(self, (size_t) indices[i], frequencies);
+		average_series(frequencies, row, MAX_YEARS, smoothing_window);
+	}
+}
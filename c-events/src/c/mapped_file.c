@@ -0,0 +1,52 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mapped_file.h"
+
+int map_file(struct mapped_file *self, const char *filename)
+{
+	struct stat st;
+	void *data;
+	int fd;
+	int err = 0;
+
+	self->data = NULL;
+	self->size = 0;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		err = 1;
+		goto out;
+	}
+
+	if (fstat(fd, &st) != 0) {
+		err = 1;
+		goto out_fd;
+	}
+
+	if (st.st_size == 0)
+		goto out_fd;
+
+	data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		err = 1;
+		goto out_fd;
+	}
+
+	self->data = data;
+	self->size = (size_t) st.st_size;
+
+out_fd:
+	close(fd);
+out:
+	return err;
+}
+
+void unmap_file(struct mapped_file *self)
+{
+	if (self->data != NULL)
+		munmap((void *) self->data, self->size);
+	self->data = NULL;
+	self->size = 0;
+}
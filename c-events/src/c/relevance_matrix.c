@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <string.h>
+#include "relevance_matrix.h"
+#include "util.h"
+
+#define COPY_BUFFER_SIZE (1 << 16)
+
+static const char *extensions[] = {
+	".csv",
+	".csr",
+	".u8",
+};
+
+const char * relevance_format_extension(enum relevance_format format)
+{
+	return extensions[format];
+}
+
+/* The matrices are little-endian whatever the host */
+static uint32_t little_endian32(uint32_t value)
+{
+	unsigned char bytes[sizeof(value)];
+	size_t i;
+
+	for (i = 0; i < sizeof(bytes); i++)
+		bytes[i] = (unsigned char) (value >> (8 * i));
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static uint64_t little_endian64(uint64_t value)
+{
+	unsigned char bytes[sizeof(value)];
+	size_t i;
+
+	for (i = 0; i < sizeof(bytes); i++)
+		bytes[i] = (unsigned char) (value >> (8 * i));
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static int write_header(struct relevance_matrix *self, uint64_t indices_offset,
+	uint64_t data_offset, uint64_t indptr_offset)
+{
+	struct relevance_matrix_header header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RELEVANCE_MATRIX_MAGIC, sizeof(header.magic));
+	header.version = little_endian32(RELEVANCE_MATRIX_VERSION);
+	header.format = little_endian32((uint32_t) self->format);
+	header.num_rows = little_endian64(self->num_rows);
+	header.num_cols = little_endian64(self->num_cols);
+	header.nnz = little_endian64(self->nnz);
+	header.indices_offset = little_endian64(indices_offset);
+	header.data_offset = little_endian64(data_offset);
+	header.indptr_offset = little_endian64(indptr_offset);
+
+	if (fseek64(self->f, 0, SEEK_SET) != 0)
+		return -1;
+	if (fwrite(&header, sizeof(header), 1, self->f) != 1)
+		return -1;
+	return 0;
+}
+
+static int pad_to_alignment(FILE *f, uint64_t *offset)
+{
+	static const char zeros[8];
+	long long position = ftell64(f);
+	size_t padding;
+
+	if (position < 0)
+		return -1;
+	padding = (size_t) ((8 - position % 8) % 8);
+	if (padding > 0 && fwrite(zeros, 1, padding, f) != padding)
+		return -1;
+	*offset = (uint64_t) position + padding;
+	return 0;
+}
+
+int init_relevance_matrix(struct relevance_matrix *self, FILE *f,
+	enum relevance_format format, size_t num_cols)
+{
+	memset(self, 0, sizeof(*self));
+	self->f = f;
+	self->format = format;
+	self->num_cols = num_cols;
+
+	if (format == RELEVANCE_CSV)
+		return 0;
+
+	self->row = malloc(num_cols * sizeof(*self->row));
+	if (self->row == NULL)
+		goto out_error;
+
+	if (format == RELEVANCE_CSR) {
+		self->row_indices = malloc(num_cols * sizeof(*self->row_indices));
+		if (self->row_indices == NULL)
+			goto out_row;
+		self->indptr_capacity = 1024;
+		self->indptr = malloc(self->indptr_capacity * sizeof(*self->indptr));
+		if (self->indptr == NULL)
+			goto out_row_indices;
+		self->indptr[0] = 0;
+		self->data = tmpfile();
+		if (self->data == NULL)
+			goto out_indptr;
+	}
+
+	return 0;
+
+out_indptr:
+	free(self->indptr);
+out_row_indices:
+	free(self->row_indices);
+out_row:
+	free(self->row);
+out_error:
+	memset(self, 0, sizeof(*self));
+	return -1;
+}
+
+static int append_csv_row(struct relevance_matrix *self, const int *counts)
+{
+	size_t i;
+
+	for (i = 0; i < self->num_cols; i++) {
+		if (i > 0)
+			fputc(',', self->f);
+		fprintf(self->f, "%d", counts[i]);
+	}
+	fputc('\n', self->f);
+	return ferror(self->f) ? -1 : 0;
+}
+
+static uint8_t to_value(int count)
+{
+	if (count <= 0)
+		return 0;
+	return count < 255 ? (uint8_t) count : 255;
+}
+
+/* Reserves the header, rewritten once the sizes are known */
+static int start_matrix(struct relevance_matrix *self)
+{
+	if (write_header(self, 0, 0, 0) != 0)
+		return -1;
+	self->started = 1;
+	return 0;
+}
+
+int append_relevance_row(struct relevance_matrix *self, const int *counts)
+{
+	size_t row_nnz = 0;
+	size_t i;
+
+	if (self->f == NULL)
+		return 0;
+	if (self->format == RELEVANCE_CSV)
+		return append_csv_row(self, counts);
+
+	if (!self->started && start_matrix(self) != 0)
+		return -1;
+
+	self->num_rows++;
+	if (self->format == RELEVANCE_DENSE) {
+		for (i = 0; i < self->num_cols; i++)
+			self->row[i] = to_value(counts[i]);
+		if (fwrite(self->row, 1, self->num_cols, self->f) != self->num_cols)
+			return -1;
+		return 0;
+	}
+
+	for (i = 0; i < self->num_cols; i++) {
+		uint8_t value = to_value(counts[i]);
+		self->row_indices[row_nnz] = (int32_t) little_endian32((uint32_t) i);
+		self->row[row_nnz] = value;
+		row_nnz += value != 0;
+	}
+	if (fwrite(self->row_indices, sizeof(*self->row_indices), row_nnz, self->f) != row_nnz)
+		return -1;
+	if (fwrite(self->row, 1, row_nnz, self->data) != row_nnz)
+		return -1;
+	self->nnz += row_nnz;
+
+	if (self->num_rows + 1 > self->indptr_capacity) {
+		size_t capacity = 2 * self->indptr_capacity;
+		int64_t *indptr = realloc(self->indptr, capacity * sizeof(*indptr));
+		if (indptr == NULL)
+			return -1;
+		self->indptr = indptr;
+		self->indptr_capacity = capacity;
+	}
+	self->indptr[self->num_rows] = (int64_t) self->nnz;
+	return 0;
+}
+
+static int finish_csr(struct relevance_matrix *self)
+{
+	char buffer[COPY_BUFFER_SIZE];
+	uint64_t data_offset, indptr_offset;
+	size_t num_read, i;
+
+	if (pad_to_alignment(self->f, &data_offset) != 0)
+		return -1;
+	rewind(self->data);
+	while ((num_read = fread(buffer, 1, sizeof(buffer), self->data)) > 0) {
+		if (fwrite(buffer, 1, num_read, self->f) != num_read)
+			return -1;
+	}
+	if (ferror(self->data))
+		return -1;
+
+	if (pad_to_alignment(self->f, &indptr_offset) != 0)
+		return -1;
+	for (i = 0; i <= self->num_rows; i++)
+		self->indptr[i] = (int64_t) little_endian64((uint64_t) self->indptr[i]);
+	if (fwrite(self->indptr, sizeof(*self->indptr), self->num_rows + 1, self->f) != self->num_rows + 1)
+		return -1;
+
+	return write_header(self, sizeof(struct relevance_matrix_header), data_offset, indptr_offset);
+}
+
+/*
+ * Completes the header of a binary matrix, with or without rows, and
+ * releases the buffers; the file itself stays open and belongs to the caller.
+ */
+int finish_relevance_matrix(struct relevance_matrix *self)
+{
+	int err = 0;
+
+	if (self->f == NULL)
+		return 0;
+
+	if (self->format != RELEVANCE_CSV && !self->started)
+		err = start_matrix(self);
+	if (err == 0 && self->format == RELEVANCE_CSR)
+		err = finish_csr(self);
+	else if (err == 0 && self->format == RELEVANCE_DENSE)
+		err = write_header(self, 0, sizeof(struct relevance_matrix_header), 0);
+
+	if (self->data != NULL)
+		fclose(self->data);
+	free(self->indptr);
+	free(self->row_indices);
+	free(self->row);
+	memset(self, 0, sizeof(*self));
+	return err;
+}
@@ -1,4 +1,5 @@
 #include "series.h"
+#include <math.h>
 
 #define SIGNIFICANT_RATIO 150.0
 
@@ -40,3 +41,105 @@ void smoothify_series(const double *in, double *out, unsigned int size, unsigned
 		}
 	}
 }
+
+/*
+ * The mean over smoothing_window years on each side, and over fewer years
+ * near the edges, in the order dictionary.py has always computed it. Wider
+ * windows than the series average the whole of it, as a window of size
+ * years does.
+ */
+void average_series(const double *in, double *out, unsigned int size, unsigned int smoothing_window)
+{
+	const size_t w = smoothing_window < size ? smoothing_window : size;
+	double smoothing_sum = 0.0;
+	size_t window_size = 0;
+	size_t i;
+
+	if (w == 0) {
+		for (i = 0; i < size; i++)
+			out[i] = in[i];
+		return;
+	}
+
+	for (i = 0; i < size + w; i++) {
+		if (i < size) {
+			smoothing_sum += in[i];
+			window_size++;
+		}
+		if (i > 2 * w) {
+			smoothing_sum -= in[i - 2 * w - 1];
+			window_size--;
+		}
+		if (smoothing_sum < 0.0)
+			smoothing_sum = 0.0;
+		if (i >= w)
+			out[i - w] = smoothing_sum / (double) window_size;
+	}
+}
+
+/*
+ * Statistics of series[inf..sup) in a single pass: the extremes, the mean and
+ * the (population) variance, the burstiness as the ratio between the peak and
+ * the mean excess over the minimum, and the largest ratio between two
+ * consecutive years, in either direction.
+ */
+void compute_series_statistics(const double *series, size_t inf, size_t sup,
+	struct series_statistics *stats)
+{
+	double min_value = series[inf];
+	double max_value = series[inf];
+	double max_ratio = 1.0;
+	double sum = 0.0;
+	double sum_squares = 0.0;
+	double n = (double) (sup - inf);
+	size_t i;
+
+	for (i = inf; i < sup; i++) {
+		double value = series[i];
+		if (value < min_value)
+			min_value = value;
+		if (value > max_value)
+			max_value = value;
+		sum += value;
+		sum_squares += value * value;
+		if (i > inf) {
+			double previous = series[i - 1];
+			double ratio;
+			if (previous > 0.0 && value > 0.0)
+				ratio = value > previous ? value / previous : previous / value;
+			else if (previous > 0.0 || value > 0.0)
+				ratio = HUGE_VAL;
+			else
+				ratio = 1.0;
+			if (ratio > max_ratio)
+				max_ratio = ratio;
+		}
+	}
+
+	stats->min_value = min_value;
+	stats->max_value = max_value;
+	stats->mean = sum / n;
+	stats->variance = sum_squares / n - stats->mean * stats->mean;
+	if (stats->variance < 0.0)
+		stats->variance = 0.0;
+	stats->burstiness = (max_value - min_value) / (stats->mean - min_value);
+	stats->max_ratio = max_ratio;
+}
+
+/*
+ * Statistics of the same series after normalize_standard_score, up to the
+ * sample versus population variance: the extremes move with the affine map,
+ * the burstiness is invariant and the consecutive ratios are lost. A flat
+ * series normalizes to NaNs, and so do its statistics.
+ */
+void normalize_series_statistics(struct series_statistics *stats)
+{
+	double mean = stats->mean;
+	double sigma = sqrt(stats->variance);
+
+	stats->min_value = (stats->min_value - mean) / sigma;
+	stats->max_value = (stats->max_value - mean) / sigma;
+	stats->mean = 0.0;
+	stats->variance = 1.0;
+	stats->max_ratio = HUGE_VAL;
+}
@@ -0,0 +1,197 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "mapped_dictionary.h"
+#include "series.h"
+#include "series_store.h"
+#include "util.h"
+
+#define MAX_THREADS 64
+
+struct build_job {
+	const struct mapped_dictionary *dict;
+	const struct series_store_header *header;
+	unsigned char *rows;
+	size_t first, last;
+};
+
+/* The series of table_to_series, read from the mapped time file */
+static void mapped_table_to_series(const struct mapped_dictionary *dict, size_t index,
+	double *series)
+{
+	const struct db_entry *entry = &dict->database[index];
+	const struct time_entry *table;
+	uint64_t year_match_count;
+	size_t j, pos;
+
+	memset(series, 0, MAX_YEARS * sizeof(*series));
+	table = (const struct time_entry *) ((const char *) dict->time_file.data + entry->time_offset);
+	for (j = 0; j < entry->time_length; j++) {
+		if (table[j].year < MIN_YEAR || table[j].year >= MIN_YEAR + MAX_YEARS)
+			continue;
+		pos = (size_t) (table[j].year - MIN_YEAR);
+		year_match_count = dict->frequencies[pos].match_count;
+		if (year_match_count != 0)
+			series[pos] = (double) (100 * table[j].match_count) / (double) year_match_count;
+	}
+}
+
+static void * build_rows(void *p)
+{
+	const struct build_job *job = p;
+	const struct series_store_header *header = job->header;
+	double series[MAX_YEARS], smooth_series[MAX_YEARS];
+	size_t i;
+
+	for (i = job->first; i < job->last; i++) {
+		mapped_table_to_series(job->dict, i, series);
+		if (header->smoothed)
+			smoothify_series(series, smooth_series, MAX_YEARS, header->smoothing_window);
+		encode_series_row(header, header->smoothed ? smooth_series : series,
+			job->rows + i * header->row_stride);
+	}
+	return NULL;
+}
+
+/*
+ * Writes the series store of a sorted dictionary, the rows split among the
+ * threads, into a temporary file which replaces the store once complete.
+ */
+int build_series_store(const char *base_filename, const char *total_counts_filename,
+	enum series_encoding encoding, int smoothed, unsigned int smoothing_window,
+	size_t num_threads)
+{
+	struct mapped_dictionary dict;
+	struct series_store_header header;
+	struct build_job jobs[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	char *filename = NULL, *temp_filename = NULL;
+	unsigned char *data;
+	size_t size, t, num_started = 0;
+	int fd;
+	int err;
+
+	err = init_mapped_dictionary(&dict, base_filename, total_counts_filename);
+	if (err != 0) {
+		fprintf(stderr, "Could not map the dictionary.\n");
+		goto out;
+	}
+
+	err = 1;
+	filename = concatenate(base_filename, ".series");
+	temp_filename = concatenate(base_filename, ".series.tmp");
+	if (filename == NULL || temp_filename == NULL)
+		goto out_dict;
+
+	init_series_store_header(&header, encoding, smoothed, smoothing_window, MAX_YEARS,
+		dict.num_words);
+	if (fingerprint_dictionary(base_filename, &header.fingerprint) != 0) {
+		fprintf(stderr, "Could not fingerprint the dictionary: %s\n", base_filename);
+		goto out_dict;
+	}
+	size = series_store_size(&header);
+	fd = open(temp_filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open for writing: %s\n", temp_filename);
+		goto out_dict;
+	}
+	if (ftruncate(fd, (off_t) size) != 0) {
+		fprintf(stderr, "Could not resize: %s\n", temp_filename);
+		goto out_fd;
+	}
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Could not map: %s\n", temp_filename);
+		goto out_fd;
+	}
+
+	for (t = 0; t < num_threads; t++) {
+		jobs[t].dict = &dict;
+		jobs[t].header = &header;
+		jobs[t].rows = data + header.rows_offset;
+		jobs[t].first = dict.num_words * t / num_threads;
+		jobs[t].last = dict.num_words * (t + 1) / num_threads;
+		if (pthread_create(&threads[t], NULL, build_rows, &jobs[t]) != 0)
+			break;
+		num_started++;
+	}
+	for (t = 0; t < num_started; t++)
+		pthread_join(threads[t], NULL);
+	/* Rows of threads which could not start are built here */
+	for (t = num_started; t < num_threads; t++)
+		build_rows(&jobs[t]);
+
+	memcpy(data, &header, sizeof(header));
+	err = msync(data, size, MS_SYNC) != 0;
+	munmap(data, size);
+	if (err == 0 && rename(temp_filename, filename) != 0)
+		err = 1;
+	if (err == 0)
+		printf("Stored the %s series of %lu words in %s\n", series_encoding_name(encoding),
+			(unsigned long) dict.num_words, filename);
+	else
+		fprintf(stderr, "Could not write: %s\n", filename);
+
+out_fd:
+	close(fd);
+	if (err != 0)
+		unlink(temp_filename);
+out_dict:
+	free(temp_filename);
+	free(filename);
+	destroy_mapped_dictionary(&dict);
+out:
+	return err;
+}
+
+/*
+ * Usage: series_builder [--encoding float32|log16] [--smoothing WINDOW]
+ *	[--threads N] [base_filename]
+ * Builds the .series of data/sort/googlebooks-eng-all-1gram-20120701-database
+ * by default: the series process and relevance compute from every table,
+ * smoothed over WINDOW years on each side with --smoothing, as float32 or
+ * log-quantized 16-bit values. process --series-store and relevance
+ * --series-store read it instead of the tables, as long as the dictionary
+ * files are those it was built from.
+ */
+int main(int argc, char **argv)
+{
+	const char *base_filename = "data/sort/googlebooks-eng-all-1gram-20120701-database";
+	enum series_encoding encoding = SERIES_FLOAT32;
+	unsigned int smoothing_window = 0;
+	int smoothed = 0;
+	long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--encoding") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "float32") == 0) {
+				encoding = SERIES_FLOAT32;
+			} else if (strcmp(argv[i], "log16") == 0) {
+				encoding = SERIES_LOG16;
+			} else {
+				fprintf(stderr, "Unknown encoding: %s\n", argv[i]);
+				return EXIT_FAILURE;
+			}
+		} else if (strcmp(argv[i], "--smoothing") == 0 && i + 1 < argc) {
+			smoothing_window = (unsigned int) strtoul(argv[++i], NULL, 10);
+			smoothed = 1;
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			num_threads = strtol(argv[++i], NULL, 10);
+		} else {
+			base_filename = argv[i];
+		}
+	}
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > MAX_THREADS)
+		num_threads = MAX_THREADS;
+
+	return build_series_store(base_filename, "data/googlebooks-eng-all-totalcounts-20120701.txt",
+		encoding, smoothed, smoothing_window, (size_t) num_threads);
+}
@@ -0,0 +1,174 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dictionary_reader.h"
+#include "series.h"
+#include "series_store.h"
+#include "util.h"
+
+static size_t value_size(uint32_t encoding)
+{
+	return encoding == SERIES_LOG16 ? sizeof(uint16_t) : sizeof(float);
+}
+
+void init_series_store_header(struct series_store_header *header, enum series_encoding encoding,
+	int smoothed, unsigned int smoothing_window, size_t num_years, size_t num_words)
+{
+	const size_t row_size = num_years * value_size(encoding);
+
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, SERIES_STORE_MAGIC, sizeof(header->magic));
+	header->version = SERIES_STORE_VERSION;
+	header->encoding = encoding;
+	header->smoothed = smoothed != 0;
+	header->smoothing_window = smoothed ? smoothing_window : 0;
+	header->num_years = (uint32_t) num_years;
+	header->num_words = num_words;
+	header->row_stride = (row_size + SERIES_STORE_ALIGNMENT - 1) / SERIES_STORE_ALIGNMENT *
+		SERIES_STORE_ALIGNMENT;
+	header->rows_offset = (sizeof(*header) + SERIES_STORE_ALIGNMENT - 1) / SERIES_STORE_ALIGNMENT *
+		SERIES_STORE_ALIGNMENT;
+	header->log_min = log(SERIES_LOG16_MIN);
+	header->log_step = (log(SERIES_LOG16_MAX) - header->log_min) / (UINT16_MAX - 1);
+}
+
+size_t series_store_size(const struct series_store_header *header)
+{
+	return (size_t) (header->rows_offset + header->num_words * header->row_stride);
+}
+
+void encode_series_row(const struct series_store_header *header, const double *series,
+	void *row)
+{
+	float *floats = row;
+	uint16_t *codes = row;
+	double code;
+	size_t i;
+
+	memset(row, 0, (size_t) header->row_stride);
+	for (i = 0; i < header->num_years; i++) {
+		if (header->encoding == SERIES_FLOAT32) {
+			floats[i] = (float) series[i];
+		} else if (series[i] > 0.0) {
+			code = 1.0 + floor((log(series[i]) - header->log_min) / header->log_step + 0.5);
+			codes[i] = (uint16_t) (code < 1.0 ? 1.0 : (code > UINT16_MAX ? UINT16_MAX : code));
+		}
+	}
+}
+
+int open_series_store(struct series_store *self, const char *filename)
+{
+	const struct series_store_header *header;
+	size_t code;
+
+	self->log16_values = NULL;
+	if (map_file(&self->file, filename) != 0)
+		return 1;
+
+	header = self->file.data;
+	if (self->file.size < sizeof(*header) ||
+			memcmp(header->magic, SERIES_STORE_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != SERIES_STORE_VERSION ||
+			(header->encoding != SERIES_FLOAT32 && header->encoding != SERIES_LOG16) ||
+			header->row_stride < header->num_years * value_size(header->encoding) ||
+			header->rows_offset > self->file.size ||
+			header->num_words > (self->file.size - header->rows_offset) /
+			(header->row_stride > 0 ? header->row_stride : 1)) {
+		unmap_file(&self->file);
+		return 1;
+	}
+
+	self->header = header;
+	self->rows = (const unsigned char *) self->file.data + header->rows_offset;
+	if (header->encoding == SERIES_LOG16) {
+		self->log16_values = malloc((UINT16_MAX + 1) * sizeof(*self->log16_values));
+		if (self->log16_values == NULL) {
+			unmap_file(&self->file);
+			return 1;
+		}
+		self->log16_values[0] = 0.0;
+		for (code = 1; code <= UINT16_MAX; code++)
+			self->log16_values[code] = exp(header->log_min + (double) (code - 1) * header->log_step);
+	}
+	return 0;
+}
+
+void close_series_store(struct series_store *self)
+{
+	free(self->log16_values);
+	self->log16_values = NULL;
+	unmap_file(&self->file);
+}
+
+/* Fills the num_years values of the word's series from its row */
+void decode_series_row(const struct series_store *self, size_t index, double *series)
+{
+	const struct series_store_header *header = self->header;
+	const void *row = self->rows + index * header->row_stride;
+	const float *floats = row;
+	const uint16_t *codes = row;
+	size_t i;
+
+	if (header->encoding == SERIES_FLOAT32) {
+		for (i = 0; i < header->num_years; i++)
+			series[i] = floats[i];
+	} else {
+		for (i = 0; i < header->num_years; i++)
+			series[i] = self->log16_values[codes[i]];
+	}
+}
+
+const char * series_encoding_name(enum series_encoding encoding)
+{
+	return encoding == SERIES_LOG16 ? "log16" : "float32";
+}
+
+/*
+ * Opens the .series of a dictionary when there is one which fits it: built
+ * from the same dictionary files, one row per word, and rows either raw or
+ * smoothed over the same window.
+ */
+int open_dictionary_series(struct series_store *self, const char *base_filename,
+	size_t num_words, unsigned int smoothing_window)
+{
+	char *filename = concatenate(base_filename, ".series");
+	struct dictionary_fingerprint fingerprint;
+	int err = 1;
+
+	if (filename == NULL || !file_exists(filename))
+		goto out;
+	if (open_series_store(self, filename) != 0) {
+		fprintf(stderr, "Ignoring the invalid series store: %s\n", filename);
+		goto out;
+	}
+	if (self->header->num_words != num_words || self->header->num_years != MAX_YEARS ||
+			(self->header->smoothed && self->header->smoothing_window != smoothing_window)) {
+		fprintf(stderr, "Ignoring the series store of another dictionary or window: %s\n",
+			filename);
+		close_series_store(self);
+		goto out;
+	}
+	if (fingerprint_dictionary(base_filename, &fingerprint) != 0 ||
+			!same_dictionary(&self->header->fingerprint, &fingerprint)) {
+		fprintf(stderr, "Ignoring the series store of an older dictionary, "
+			"rebuild it with series_builder: %s\n", filename);
+		close_series_store(self);
+		goto out;
+	}
+	err = 0;
+out:
+	free(filename);
+	return err;
+}
+
+/* The smoothed series of the word, smoothing it here when the store did not */
+void series_store_smoothed(const struct series_store *self, size_t index,
+	unsigned int smoothing_window, double *series, double *smooth_series)
+{
+	if (self->header->smoothed) {
+		decode_series_row(self, index, smooth_series);
+	} else {
+		decode_series_row(self, index, series);
+		smoothify_series(series, smooth_series, self->header->num_years, smoothing_window);
+	}
+}
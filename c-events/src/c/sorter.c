@@ -4,11 +4,81 @@
 #include "dictionary_reader.h"
 #include "dictionary_types.h"
 #include "util.h"
+#include "word_index.h"
+#include "word_stats.h"
 
 #define MAX_ENTRIES (1 << 20)
 
 struct indexed_word words[MAX_ENTRIES];
 
+/*
+ * Writes the perfect hash of the sorted words, which find_word uses, with the
+ * fingerprint of the dictionary files, which must be closed by then.
+ */
+static int write_sorted_index(const char *base_filename, const char *filename,
+	size_t num_words)
+{
+	struct dictionary_fingerprint fingerprint;
+	const char **sorted;
+	size_t *lengths;
+	size_t i;
+	FILE *f;
+	int err = 1;
+
+	sorted = malloc(num_words * sizeof(*sorted) + 1);
+	lengths = malloc(num_words * sizeof(*lengths) + 1);
+	if (sorted == NULL || lengths == NULL)
+		goto out;
+	if (fingerprint_dictionary(base_filename, &fingerprint) != 0) {
+		fprintf(stderr, "Could not fingerprint the dictionary: %s\n", base_filename);
+		goto out;
+	}
+	for (i = 0; i < num_words; i++) {
+		sorted[i] = words[i].word;
+		lengths[i] = strlen(words[i].word);
+	}
+
+	f = fopen(filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open: %s\n", filename);
+		goto out;
+	}
+	err = write_word_index(f, sorted, lengths, num_words, &fingerprint);
+	if (fclose(f) != 0)
+		err = 1;
+
+out:
+	free(lengths);
+	free(sorted);
+	return err;
+}
+
+/*
+ * Writes the statistics which word_selection filters and ranks on, with the
+ * fingerprint of the dictionary files, which must be closed by then.
+ */
+static int write_sorted_stats(const char *base_filename, const char *filename,
+	const struct word_stats *stats, size_t num_words)
+{
+	struct dictionary_fingerprint fingerprint;
+	FILE *f;
+	int err;
+
+	if (fingerprint_dictionary(base_filename, &fingerprint) != 0) {
+		fprintf(stderr, "Could not fingerprint the dictionary: %s\n", base_filename);
+		return 1;
+	}
+	f = fopen(filename, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open: %s\n", filename);
+		return 1;
+	}
+	err = write_word_stats(f, stats, num_words, &fingerprint);
+	if (fclose(f) != 0)
+		err = 1;
+	return err;
+}
+
 int sort_binary_data()
 {
 	struct time_entry table[MAX_YEARS];
@@ -16,6 +86,7 @@ int sort_binary_data()
 	struct db_entry *entry;
 	struct dictionary_reader dictreader;
 	struct dictionary_files out_files;
+	struct word_stats *stats;
 	size_t tlength, wlength;
 	size_t num_written;
 	size_t i, index;
@@ -37,6 +108,12 @@ int sort_binary_data()
 
 	printf("num_words=%lu\n", dictreader.num_words);
 
+	stats = malloc(dictreader.num_words * sizeof(*stats) + 1);
+	if (stats == NULL) {
+		err = 1;
+		goto out_files;
+	}
+
 	for (i = 0; i < dictreader.num_words; i++) {
 		words[i].index = i;
 		words[i].word = dictreader.words[i];
@@ -54,11 +131,16 @@ int sort_binary_data()
 
 		entry = &dictreader.database[index];
 		wlength = strlen(word);
+		compute_word_stats(table, tlength, dictreader.frequencies, word, wlength, &stats[i]);
 
 		entry->word_offset = wr_woffset;
 		entry->time_offset = wr_toffset;
 		fwrite(entry, sizeof(*entry), 1, out_files.main_file);
-		fwrite(word, sizeof(*word), wlength, out_files.word_file);
+		if (fwrite(word, sizeof(*word), wlength, out_files.word_file) != wlength) {
+			fprintf(stderr, "Could not write the %luth word.\n", (unsigned long) i);
+			err = 1;
+			goto out_files;
+		}
 		num_written = fwrite(table, sizeof(*table), tlength, out_files.time_file);
 		if (num_written != tlength) {
 			fprintf(stderr, "Tried writing %lu entries in the time file, but managed only %lu.",
@@ -75,6 +157,21 @@ int sort_binary_data()
 
 out_files:
 	destroy_dictfiles(&out_files);
+	if (err == 0) {
+		err = write_sorted_index("data/temp/googlebooks-eng-all-1gram-20120701-database",
+			"data/temp/googlebooks-eng-all-1gram-20120701-database.index",
+			dictreader.num_words);
+		if (err != 0)
+			fprintf(stderr, "Could not write the word index.\n");
+	}
+	if (err == 0) {
+		err = write_sorted_stats("data/temp/googlebooks-eng-all-1gram-20120701-database",
+			"data/temp/googlebooks-eng-all-1gram-20120701-database.stats",
+			stats, dictreader.num_words);
+		if (err != 0)
+			fprintf(stderr, "Could not write the word statistics.\n");
+	}
+	free(stats);
 out_reader:
 	destroy_dictreader(&dictreader);
 out:
@@ -0,0 +1,152 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "trace.h"
+
+struct trace_buffer {
+	FILE *f;
+	size_t used;
+	uint64_t sequence;
+	struct trace_record records[TRACE_BUFFER_SIZE];
+};
+
+static const char *event_names[] = {
+	"word",
+	"gaussian_candidate",
+	"gaussian_accepted",
+	"linear_range",
+	"discrepancy_segment",
+};
+
+static __thread struct trace_buffer *thread_buffer = NULL;
+static __thread int thread_failed = 0;
+static pthread_key_t buffer_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static unsigned int num_buffers = 0;
+
+static void write_buffer(struct trace_buffer *buffer)
+{
+	if (buffer->used > 0 &&
+			fwrite(buffer->records, sizeof(*buffer->records), buffer->used, buffer->f) != buffer->used)
+		fprintf(stderr, "Could not write the trace\n");
+	buffer->used = 0;
+}
+
+/* Runs when a thread ends, and for the main thread when the process does */
+static void release_buffer(void *p)
+{
+	struct trace_buffer *buffer = p;
+
+	write_buffer(buffer);
+	fclose(buffer->f);
+	free(buffer);
+}
+
+static void release_thread_buffer(void)
+{
+	if (thread_buffer == NULL)
+		return;
+	pthread_setspecific(buffer_key, NULL);
+	release_buffer(thread_buffer);
+	thread_buffer = NULL;
+}
+
+static void create_key(void)
+{
+	pthread_key_create(&buffer_key, release_buffer);
+	atexit(release_thread_buffer);
+}
+
+static struct trace_buffer * get_buffer(void)
+{
+	struct trace_header header;
+	struct trace_buffer *buffer;
+	char filename[64];
+
+	if (thread_buffer != NULL || thread_failed)
+		return thread_buffer;
+	pthread_once(&key_once, create_key);
+
+	thread_failed = 1;
+	buffer = calloc(1, sizeof(*buffer));
+	if (buffer == NULL)
+		return NULL;
+	snprintf(filename, sizeof(filename), "trace-%ld-%u.bin", (long) getpid(),
+		__sync_fetch_and_add(&num_buffers, 1));
+	buffer->f = fopen(filename, "wb");
+	if (buffer->f == NULL) {
+		fprintf(stderr, "Could not open for writing: %s\n", filename);
+		free(buffer);
+		return NULL;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(struct trace_record);
+	if (fwrite(&header, sizeof(header), 1, buffer->f) != 1) {
+		fprintf(stderr, "Could not write the trace header: %s\n", filename);
+		fclose(buffer->f);
+		free(buffer);
+		return NULL;
+	}
+
+	thread_failed = 0;
+	thread_buffer = buffer;
+	pthread_setspecific(buffer_key, buffer);
+	return buffer;
+}
+
+static struct trace_record * next_record(unsigned int category, enum trace_event event)
+{
+	struct trace_buffer *buffer = get_buffer();
+	struct trace_record *record;
+
+	if (buffer == NULL)
+		return NULL;
+	if (buffer->used == TRACE_BUFFER_SIZE)
+		write_buffer(buffer);
+	record = &buffer->records[buffer->used++];
+	memset(record, 0, sizeof(*record));
+	record->sequence = buffer->sequence++;
+	record->category = (uint16_t) category;
+	record->event = (uint16_t) event;
+	return record;
+}
+
+void trace_record(unsigned int category, enum trace_event event, const double *values,
+	size_t num_values)
+{
+	struct trace_record *record = next_record(category, event);
+
+	if (record == NULL)
+		return;
+	if (num_values > TRACE_MAX_VALUES)
+		num_values = TRACE_MAX_VALUES;
+	record->num_values = (uint32_t) num_values;
+	memcpy(record->values, values, num_values * sizeof(*values));
+}
+
+void trace_word(const char *word)
+{
+	struct trace_record *record = next_record(TRACE_WORDS, TRACE_WORD);
+
+	if (record != NULL)
+		strncpy((char *) record->values, word, sizeof(record->values) - 1);
+}
+
+/* Writes what the calling thread traced so far */
+void trace_flush(void)
+{
+	if (thread_buffer != NULL) {
+		write_buffer(thread_buffer);
+		fflush(thread_buffer->f);
+	}
+}
+
+const char * trace_event_name(enum trace_event event)
+{
+	return (size_t) event < sizeof(event_names) / sizeof(*event_names) ? event_names[event] : "unknown";
+}
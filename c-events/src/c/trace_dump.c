@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+/* Prints the records of a trace file, one per line */
+int dump_trace(const char *filename)
+{
+	struct trace_header header;
+	struct trace_record record;
+	char word[sizeof(record.values)];
+	uint32_t i;
+	FILE *f;
+	int err = 0;
+
+	f = fopen(filename, "rb");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open for reading: %s\n", filename);
+		err = 1;
+		goto out;
+	}
+
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+			memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+			header.version != TRACE_VERSION || header.record_size != sizeof(record)) {
+		fprintf(stderr, "Not a trace of this build: %s\n", filename);
+		err = 1;
+		goto out_file;
+	}
+
+	while (fread(&record, sizeof(record), 1, f) == 1) {
+		if (record.event == TRACE_WORD) {
+			memcpy(word, record.values, sizeof(word));
+			word[sizeof(word) - 1] = 0;
+			printf("%llu\tword\t%s\n", (unsigned long long) record.sequence, word);
+			continue;
+		}
+		printf("%llu\t%s", (unsigned long long) record.sequence,
+			trace_event_name((enum trace_event) record.event));
+		for (i = 0; i < record.num_values && i < TRACE_MAX_VALUES; i++)
+			printf("\t%g", record.values[i]);
+		printf("\n");
+	}
+
+out_file:
+	fclose(f);
+out:
+	return err;
+}
+
+/*
+ * Usage: trace_dump FILE...
+ * Prints the trace-PID-N.bin files which the detectors write when built with
+ * TRACE_LEVEL, as tab-separated sequence, event and values.
+ */
+int main(int argc, char **argv)
+{
+	int i, err = 0;
+
+	for (i = 1; i < argc; i++)
+		if (dump_trace(argv[i]) != 0)
+			err = 1;
+	return err;
+}
@@ -1,6 +1,8 @@
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "util.h"
 
 char * concatenate(const char *left, const char *right)
@@ -58,3 +60,13 @@ int file_exists(const char *filename)
 {
 	return access(filename, F_OK) == 0;
 }
+
+int make_directory(const char *path)
+{
+#ifdef _WIN32
+	int err = mkdir(path);
+#else
+	int err = mkdir(path, 0755);
+#endif
+	return err == 0 || errno == EEXIST ? 0 : -1;
+}
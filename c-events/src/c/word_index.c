@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "word_index.h"
+
+#define DIRECT_SLOT 0x80000000U
+#define WORDS_PER_BUCKET 4
+#define MAX_DISPLACEMENT (1U << 24)
+#define MAX_SEEDS 16
+
+static uint64_t mix64(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static uint64_t hash_word(const char *word, size_t length, uint32_t seed)
+{
+	uint64_t h = 0xcbf29ce484222325ULL ^ mix64(seed);
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		h ^= (unsigned char) word[i];
+		h *= 0x100000001b3ULL;
+	}
+	return mix64(h);
+}
+
+static size_t displaced_slot(uint64_t h, uint32_t displacement, uint64_t num_words)
+{
+	return (size_t) (mix64(h ^ (displacement * 0x9e3779b97f4a7c15ULL)) % num_words);
+}
+
+static int compare_descending(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+/*
+ * Places the buckets from the largest, trying displacements until all their
+ * words fall on distinct free slots, then puts the single words in whatever
+ * slots remain. Returns 1 when a bucket cannot be placed, which happens when
+ * two words share a hash, so that another seed gets tried.
+ */
+static int place_buckets(const uint64_t *hashes, size_t num_words, size_t num_buckets,
+	uint32_t *displacements, uint32_t *slots, uint32_t *starts, uint32_t *members,
+	uint64_t *order, unsigned char *taken, size_t *positions)
+{
+	size_t i, j, k, b, size, next_free = 0;
+	uint32_t d;
+
+	memset(starts, 0, (num_buckets + 1) * sizeof(*starts));
+	for (i = 0; i < num_words; i++)
+		starts[hashes[i] % num_buckets + 1]++;
+	for (b = 0; b < num_buckets; b++)
+		starts[b + 1] += starts[b];
+	for (i = 0; i < num_words; i++) {
+		b = (size_t) (hashes[i] % num_buckets);
+		members[starts[b]++] = (uint32_t) i;
+	}
+	for (b = num_buckets; b > 0; b--)
+		starts[b] = starts[b - 1];
+	starts[0] = 0;
+
+	for (b = 0; b < num_buckets; b++)
+		order[b] = ((uint64_t) (starts[b + 1] - starts[b]) << 32) | b;
+	qsort(order, num_buckets, sizeof(*order), compare_descending);
+	memset(taken, 0, num_words);
+	memset(displacements, 0, num_buckets * sizeof(*displacements));
+
+	for (k = 0; k < num_buckets; k++) {
+		b = (size_t) (order[k] & 0xffffffffU);
+		size = (size_t) (order[k] >> 32);
+		if (size == 0)
+			break;
+
+		if (size == 1) {
+			while (taken[next_free])
+				next_free++;
+			taken[next_free] = 1;
+			slots[next_free] = members[starts[b]];
+			displacements[b] = DIRECT_SLOT | (uint32_t) next_free;
+			continue;
+		}
+
+		for (d = 0; d < MAX_DISPLACEMENT; d++) {
+			for (i = 0; i < size; i++) {
+				positions[i] = displaced_slot(hashes[members[starts[b] + i]], d, num_words);
+				if (taken[positions[i]])
+					break;
+				for (j = 0; j < i && positions[j] != positions[i]; j++)
+					;
+				if (j < i)
+					break;
+			}
+			if (i == size)
+				break;
+		}
+		if (d == MAX_DISPLACEMENT)
+			return 1;
+
+		for (i = 0; i < size; i++) {
+			taken[positions[i]] = 1;
+			slots[positions[i]] = members[starts[b] + i];
+		}
+		displacements[b] = d;
+	}
+
+	return 0;
+}
+
+static int write_aligned(FILE *f, const void *data, size_t size)
+{
+	static const char zeros[8] = { 0 };
+
+	if (size > 0 && fwrite(data, 1, size, f) != size)
+		return 1;
+	if (size % 8 != 0 && fwrite(zeros, 1, 8 - size % 8, f) != 8 - size % 8)
+		return 1;
+	return 0;
+}
+
+/* Builds the index of the words, which must be distinct */
+int write_word_index(FILE *f, const char **words, const size_t *lengths, size_t num_words,
+	const struct dictionary_fingerprint *fingerprint)
+{
+	struct word_index_header header;
+	size_t num_buckets = num_words / WORDS_PER_BUCKET + 1;
+	uint64_t *hashes = NULL, *order = NULL;
+	uint32_t *displacements = NULL, *slots = NULL, *starts = NULL, *members = NULL;
+	unsigned char *taken = NULL;
+	size_t *positions = NULL;
+	uint32_t seed;
+	size_t i;
+	int err = 1;
+
+	if (num_words >= DIRECT_SLOT)
+		goto out;
+
+	hashes = malloc((num_words + 1) * sizeof(*hashes));
+	order = malloc(num_buckets * sizeof(*order));
+	displacements = malloc(num_buckets * sizeof(*displacements));
+	slots = malloc((num_words + 1) * sizeof(*slots));
+	starts = malloc((num_buckets + 1) * sizeof(*starts));
+	members = malloc((num_words + 1) * sizeof(*members));
+	taken = malloc(num_words + 1);
+	positions = malloc((num_words + 1) * sizeof(*positions));
+	if (hashes == NULL || order == NULL || displacements == NULL || slots == NULL ||
+			starts == NULL || members == NULL || taken == NULL || positions == NULL) {
+		fprintf(stderr, "Could not allocate memory for the word index\n");
+		goto out;
+	}
+
+	for (seed = 1; seed <= MAX_SEEDS; seed++) {
+		for (i = 0; i < num_words; i++)
+			hashes[i] = hash_word(words[i], lengths[i], seed);
+		err = place_buckets(hashes, num_words, num_buckets, displacements, slots,
+			starts, members, order, taken, positions);
+		if (err == 0)
+			break;
+	}
+	if (err != 0) {
+		fprintf(stderr, "Could not build the word index, are the words distinct?\n");
+		goto out;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, WORD_INDEX_MAGIC, sizeof(header.magic));
+	header.version = WORD_INDEX_VERSION;
+	header.seed = seed;
+	header.num_words = num_words;
+	header.num_buckets = num_buckets;
+	header.displacements_offset = sizeof(header);
+	header.slots_offset = header.displacements_offset +
+		(num_buckets * sizeof(*displacements) + 7) / 8 * 8;
+	header.fingerprint = *fingerprint;
+
+	if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+			write_aligned(f, displacements, num_buckets * sizeof(*displacements)) != 0 ||
+			write_aligned(f, slots, num_words * sizeof(*slots)) != 0)
+		err = 1;
+
+out:
+	free(positions);
+	free(taken);
+	free(members);
+	free(starts);
+	free(slots);
+	free(displacements);
+	free(order);
+	free(hashes);
+	return err;
+}
+
+/* Whether count entries of size bytes at offset lie within the file */
+static int within_file(const struct word_index *self, uint64_t offset, uint64_t count,
+	size_t size)
+{
+	return offset <= self->file.size && count <= (self->file.size - offset) / size;
+}
+
+int open_word_index(struct word_index *self, const char *filename)
+{
+	const struct word_index_header *header;
+	const char *base;
+
+	if (map_file(&self->file, filename) != 0)
+		return 1;
+
+	header = self->header = self->file.data;
+	if (self->file.size < sizeof(*header) ||
+			memcmp(header->magic, WORD_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != WORD_INDEX_VERSION ||
+			(header->num_words != 0 && header->num_buckets == 0) ||
+			!within_file(self, header->displacements_offset, header->num_buckets,
+				sizeof(uint32_t)) ||
+			!within_file(self, header->slots_offset, header->num_words, sizeof(uint32_t))) {
+		unmap_file(&self->file);
+		return 1;
+	}
+
+	base = self->file.data;
+	self->displacements = (const uint32_t *) (base + self->header->displacements_offset);
+	self->slots = (const uint32_t *) (base + self->header->slots_offset);
+	return 0;
+}
+
+void close_word_index(struct word_index *self)
+{
+	unmap_file(&self->file);
+}
+
+/*
+ * Opens the .index of a dictionary unless it is missing, invalid, or was
+ * built from other dictionary files, in which case the callers bisect.
+ */
+int open_dictionary_index(struct word_index *self, const char *base_filename,
+	size_t num_words)
+{
+	char *filename = concatenate(base_filename, ".index");
+	struct dictionary_fingerprint fingerprint;
+	int err = 1;
+
+	if (filename == NULL || !file_exists(filename))
+		goto out;
+	if (open_word_index(self, filename) != 0) {
+		fprintf(stderr, "Ignoring the invalid word index: %s\n", filename);
+		goto out;
+	}
+	if (self->header->num_words != num_words ||
+			fingerprint_dictionary(base_filename, &fingerprint) != 0 ||
+			!same_dictionary(&self->header->fingerprint, &fingerprint)) {
+		fprintf(stderr, "Ignoring the stale word index, rebuild it with indexer: %s\n",
+			filename);
+		close_word_index(self);
+		goto out;
+	}
+	err = 0;
+out:
+	free(filename);
+	return err;
+}
+
+/* The only word which the string may be, or (size_t) -1 for an empty index */
+size_t word_index_candidate(const struct word_index *self, const char *word, size_t length)
+{
+	const struct word_index_header *header = self->header;
+	uint64_t h;
+	uint32_t d;
+
+	if (header->num_words == 0)
+		return (size_t) -1;
+
+	h = hash_word(word, length, header->seed);
+	d = self->displacements[h % header->num_buckets];
+	if (d & DIRECT_SLOT)
+		return self->slots[d & ~DIRECT_SLOT];
+	return self->slots[displaced_slot(h, d, header->num_words)];
+}
@@ -0,0 +1,312 @@
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include "word_selection.h"
+
+struct offset_entry {
+	uint32_t time_offset;
+	size_t index;
+	float burstiness;
+};
+
+void init_word_selection(struct word_selection *self)
+{
+	memset(self, 0, sizeof(*self));
+	self->max_match_count = UINT64_MAX;
+	self->max_peak_year = UINT16_MAX;
+	self->max_first_year = UINT16_MAX;
+	self->pos_tags = POS_TAGS_INCLUDE;
+}
+
+/*
+ * Reads --words FILE, --regex PATTERN, --prefix PREFIX, --min-count N and
+ * --max-count N from the command line, and the criteria on the statistics:
+ * --min-peak-year Y, --max-peak-year Y, --max-first-year Y, --min-last-year Y,
+ * --min-active-years N, --min-frequency F (of the peak), --min-variance V,
+ * --pos-tags include|exclude|only and --top-bursty N.
+ */
+int parse_word_selection(struct word_selection *self, int argc, char **argv)
+{
+	const char *option, *value;
+	int i;
+
+	for (i = 1; i < argc; i += 2) {
+		option = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing the value of: %s\n", option);
+			return 1;
+		}
+		value = argv[i + 1];
+		if (strcmp(option, "--words") == 0) {
+			self->words_filename = value;
+		} else if (strcmp(option, "--regex") == 0) {
+			self->pattern = value;
+		} else if (strcmp(option, "--prefix") == 0) {
+			self->prefix = value;
+		} else if (strcmp(option, "--min-count") == 0) {
+			self->min_match_count = strtoull(value, NULL, 10);
+		} else if (strcmp(option, "--max-count") == 0) {
+			self->max_match_count = strtoull(value, NULL, 10);
+		} else if (strcmp(option, "--min-peak-year") == 0) {
+			self->min_peak_year = (unsigned int) strtoul(value, NULL, 10);
+		} else if (strcmp(option, "--max-peak-year") == 0) {
+			self->max_peak_year = (unsigned int) strtoul(value, NULL, 10);
+		} else if (strcmp(option, "--max-first-year") == 0) {
+			self->max_first_year = (unsigned int) strtoul(value, NULL, 10);
+		} else if (strcmp(option, "--min-last-year") == 0) {
+			self->min_last_year = (unsigned int) strtoul(value, NULL, 10);
+		} else if (strcmp(option, "--min-active-years") == 0) {
+			self->min_active_years = (unsigned int) strtoul(value, NULL, 10);
+		} else if (strcmp(option, "--min-frequency") == 0) {
+			self->min_max_frequency = strtod(value, NULL);
+		} else if (strcmp(option, "--min-variance") == 0) {
+			self->min_variance = strtod(value, NULL);
+		} else if (strcmp(option, "--pos-tags") == 0) {
+			if (strcmp(value, "include") == 0) {
+				self->pos_tags = POS_TAGS_INCLUDE;
+			} else if (strcmp(value, "exclude") == 0) {
+				self->pos_tags = POS_TAGS_EXCLUDE;
+			} else if (strcmp(value, "only") == 0) {
+				self->pos_tags = POS_TAGS_ONLY;
+			} else {
+				fprintf(stderr, "Unknown value of --pos-tags: %s\n", value);
+				return 1;
+			}
+		} else if (strcmp(option, "--top-bursty") == 0) {
+			self->top_bursty = (size_t) strtoul(value, NULL, 10);
+		} else {
+			fprintf(stderr, "Unknown option: %s\n", option);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Whether any criterion needs the .stats of the dictionary */
+int uses_word_stats(const struct word_selection *self)
+{
+	return self->min_peak_year != 0 || self->max_peak_year != UINT16_MAX ||
+		self->max_first_year != UINT16_MAX || self->min_last_year != 0 ||
+		self->min_active_years != 0 || self->min_max_frequency != 0.0 ||
+		self->min_variance != 0.0 || self->pos_tags != POS_TAGS_INCLUDE ||
+		self->top_bursty != 0;
+}
+
+int is_word_selection_empty(const struct word_selection *self)
+{
+	return self->words_filename == NULL && self->pattern == NULL && self->prefix == NULL &&
+		self->min_match_count == 0 && self->max_match_count == UINT64_MAX &&
+		!uses_word_stats(self);
+}
+
+/*
+ * Looks up every line of the file, skipping the words not in the dictionary
+ * and those already listed, so that the list never outgrows the dictionary.
+ */
+static int find_listed_words(const struct dictionary_reader *dict, const char *filename,
+	size_t *indices, size_t *num_indices)
+{
+	unsigned char *seen;
+	char *line = NULL;
+	size_t capacity = 0, length, num_unknown = 0;
+	ssize_t num_read;
+	long index;
+	FILE *f;
+
+	seen = calloc(dict->num_words / 8 + 1, sizeof(*seen));
+	if (seen == NULL)
+		return 1;
+	f = fopen(filename, "rt");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open for reading: %s\n", filename);
+		free(seen);
+		return 1;
+	}
+
+	*num_indices = 0;
+	while ((num_read = getline(&line, &capacity, f)) > 0) {
+		length = (size_t) num_read;
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			length--;
+		line[length] = 0;
+		if (length == 0)
+			continue;
+		index = find_word(dict, line);
+		if (index < 0) {
+			num_unknown++;
+			continue;
+		}
+		if (seen[index / 8] & (1u << (index % 8)))
+			continue;
+		seen[index / 8] |= (unsigned char) (1u << (index % 8));
+		indices[(*num_indices)++] = (size_t) index;
+	}
+
+	if (num_unknown > 0)
+		printf("%lu listed words are not in the dictionary\n", (unsigned long) num_unknown);
+	free(line);
+	fclose(f);
+	free(seen);
+	return 0;
+}
+
+/* The first word which does not sort before the key, or after it when above is set */
+static size_t bisect_prefix(const struct dictionary_reader *dict, const char *prefix,
+	size_t length, int above)
+{
+	size_t low = 0, high = dict->num_words, middle;
+	int cmp;
+
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		cmp = strncmp(dict->words[middle], prefix, length);
+		if (cmp < 0 || (above && cmp == 0))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+/* The criteria on the statistics, which are the cheapest after the counts */
+static int is_within_stats(const struct word_selection *self, const struct word_stats *stats)
+{
+	const int pos_tagged = (stats->flags & WORD_STATS_POS_TAGGED) != 0;
+
+	if ((self->pos_tags == POS_TAGS_EXCLUDE && pos_tagged) ||
+			(self->pos_tags == POS_TAGS_ONLY && !pos_tagged))
+		return 0;
+	if (stats->active_years < self->min_active_years)
+		return 0;
+	if (stats->peak_year < self->min_peak_year || stats->peak_year > self->max_peak_year)
+		return 0;
+	if (stats->first_year > self->max_first_year || stats->last_year < self->min_last_year)
+		return 0;
+	return stats->max_frequency >= self->min_max_frequency &&
+		stats->variance >= self->min_variance;
+}
+
+static int is_selected(const struct dictionary_reader *dict, const struct word_selection *self,
+	const regex_t *pattern, size_t index)
+{
+	const char *word = dict->words[index];
+	uint64_t match_count = dict->database[index].total_match_count;
+
+	if (match_count < self->min_match_count || match_count > self->max_match_count)
+		return 0;
+	if (dict->has_stats && !is_within_stats(self, &dict->stats.entries[index]))
+		return 0;
+	if (self->prefix != NULL && strncmp(word, self->prefix, strlen(self->prefix)) != 0)
+		return 0;
+	return pattern == NULL || regexec(pattern, word, 0, NULL, 0) == 0;
+}
+
+/* Highest burstiness first, ties in the order of the time file */
+static int compare_burstiness(const void *a, const void *b)
+{
+	const struct offset_entry *x = a;
+	const struct offset_entry *y = b;
+
+	if (x->burstiness != y->burstiness)
+		return x->burstiness > y->burstiness ? -1 : 1;
+	return x->time_offset < y->time_offset ? -1 : (x->time_offset > y->time_offset ? 1 : 0);
+}
+
+static int compare_offsets(const void *a, const void *b)
+{
+	const struct offset_entry *x = a;
+	const struct offset_entry *y = b;
+
+	if (x->time_offset != y->time_offset)
+		return x->time_offset < y->time_offset ? -1 : 1;
+	return x->index < y->index ? -1 : (x->index > y->index ? 1 : 0);
+}
+
+/*
+ * Fills indices with the selected words of a sorted dictionary, ordered by
+ * their position in the time file so that reading their tables only moves
+ * forward. The word list and the prefix are resolved through find_word and
+ * bisection, so only the regular expression, the counts and the statistics
+ * look at every candidate. With top_bursty, only that many words of highest
+ * burstiness remain. The caller frees indices.
+ */
+int select_words(const struct dictionary_reader *dict, const struct word_selection *self,
+	size_t **indices, size_t *num_indices)
+{
+	regex_t pattern;
+	struct offset_entry *entries = NULL;
+	size_t *candidates;
+	size_t i, first = 0, last = dict->num_words, num_candidates = 0, num_selected = 0;
+	int err = 0;
+
+	*indices = NULL;
+	*num_indices = 0;
+
+	if (uses_word_stats(self) && !dict->has_stats) {
+		fprintf(stderr, "Selecting on the statistics needs the .stats of the dictionary, "
+			"which sorter and indexer write.\n");
+		return 1;
+	}
+
+	if (self->pattern != NULL) {
+		err = regcomp(&pattern, self->pattern, REG_EXTENDED | REG_NOSUB);
+		if (err != 0) {
+			fprintf(stderr, "Invalid regular expression: %s\n", self->pattern);
+			return 1;
+		}
+	}
+
+	candidates = malloc(dict->num_words * sizeof(*candidates) + 1);
+	if (candidates == NULL) {
+		err = 1;
+		goto out_pattern;
+	}
+
+	if (self->words_filename != NULL) {
+		err = find_listed_words(dict, self->words_filename, candidates, &num_candidates);
+		if (err != 0)
+			goto out_candidates;
+	} else {
+		if (self->prefix != NULL) {
+			first = bisect_prefix(dict, self->prefix, strlen(self->prefix), 0);
+			last = bisect_prefix(dict, self->prefix, strlen(self->prefix), 1);
+		}
+		for (i = first; i < last; i++)
+			candidates[num_candidates++] = i;
+	}
+
+	entries = malloc(num_candidates * sizeof(*entries) + 1);
+	if (entries == NULL) {
+		err = 1;
+		goto out_candidates;
+	}
+	for (i = 0; i < num_candidates; i++) {
+		if (!is_selected(dict, self, self->pattern != NULL ? &pattern : NULL, candidates[i]))
+			continue;
+		entries[num_selected].time_offset = dict->database[candidates[i]].time_offset;
+		entries[num_selected].index = candidates[i];
+		entries[num_selected].burstiness = dict->has_stats ?
+			dict->stats.entries[candidates[i]].burstiness : 0.0f;
+		num_selected++;
+	}
+	qsort(entries, num_selected, sizeof(*entries), compare_offsets);
+	*num_indices = num_selected;
+
+	if (self->top_bursty > 0 && *num_indices > self->top_bursty) {
+		qsort(entries, *num_indices, sizeof(*entries), compare_burstiness);
+		*num_indices = self->top_bursty;
+		qsort(entries, *num_indices, sizeof(*entries), compare_offsets);
+	}
+	for (i = 0; i < *num_indices; i++)
+		candidates[i] = entries[i].index;
+	*indices = candidates;
+	candidates = NULL;
+
+	free(entries);
+out_candidates:
+	free(candidates);
+out_pattern:
+	if (self->pattern != NULL)
+		regfree(&pattern);
+	return err;
+}
@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dictionary_reader.h"
+#include "series.h"
+#include "util.h"
+#include "word_stats.h"
+
+/* The statistics of one word, from its table as sorter or the .time file holds it */
+void compute_word_stats(const struct time_entry *table, size_t table_size,
+	const struct total_counts_entry *frequencies, const char *word, size_t word_length,
+	struct word_stats *stats)
+{
+	double series[MAX_YEARS];
+	struct series_statistics span;
+	uint64_t year_match_count;
+	size_t i, pos, first = MAX_YEARS, last = 0, peak = 0, active_years = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	if (memchr(word, '_', word_length) != NULL)
+		stats->flags |= WORD_STATS_POS_TAGGED;
+
+	memset(series, 0, sizeof(series));
+	for (i = 0; i < table_size; i++) {
+		if (table[i].year < MIN_YEAR || table[i].year >= MIN_YEAR + MAX_YEARS)
+			continue;
+		pos = (size_t) (table[i].year - MIN_YEAR);
+		year_match_count = frequencies[pos].match_count;
+		if (year_match_count == 0 || table[i].match_count == 0)
+			continue;
+		series[pos] = (double) (100 * table[i].match_count) / (double) year_match_count;
+	}
+	for (pos = 0; pos < MAX_YEARS; pos++) {
+		if (series[pos] == 0.0)
+			continue;
+		if (first == MAX_YEARS)
+			first = pos;
+		last = pos;
+		if (series[pos] > series[peak])
+			peak = pos;
+		active_years++;
+	}
+	if (active_years == 0)
+		return;
+
+	compute_series_statistics(series, first, last + 1, &span);
+	stats->first_year = (uint16_t) (MIN_YEAR + first);
+	stats->last_year = (uint16_t) (MIN_YEAR + last);
+	stats->peak_year = (uint16_t) (MIN_YEAR + peak);
+	stats->active_years = (uint16_t) active_years;
+	stats->max_frequency = (float) span.max_value;
+	stats->mean_frequency = (float) span.mean;
+	stats->variance = (float) span.variance;
+	/* A flat span has no excess over its minimum, hence no burst */
+	stats->burstiness = span.mean > span.min_value ? (float) span.burstiness : 0.0f;
+}
+
+int write_word_stats(FILE *f, const struct word_stats *stats, size_t num_words,
+	const struct dictionary_fingerprint *fingerprint)
+{
+	struct word_stats_header header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, WORD_STATS_MAGIC, sizeof(header.magic));
+	header.version = WORD_STATS_VERSION;
+	header.record_size = sizeof(*stats);
+	header.num_words = num_words;
+	header.fingerprint = *fingerprint;
+
+	if (fwrite(&header, sizeof(header), 1, f) != 1)
+		return 1;
+	if (fwrite(stats, sizeof(*stats), num_words, f) != num_words)
+		return 1;
+	return 0;
+}
+
+int open_word_stats(struct word_stats_file *self, const char *filename)
+{
+	const struct word_stats_header *header;
+
+	if (map_file(&self->file, filename) != 0)
+		return 1;
+
+	header = self->file.data;
+	if (self->file.size < sizeof(*header) ||
+			memcmp(header->magic, WORD_STATS_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != WORD_STATS_VERSION ||
+			header->record_size != sizeof(struct word_stats) ||
+			header->num_words > (self->file.size - sizeof(*header)) / sizeof(struct word_stats)) {
+		unmap_file(&self->file);
+		return 1;
+	}
+
+	self->header = header;
+	self->entries = (const struct word_stats *) (header + 1);
+	return 0;
+}
+
+void close_word_stats(struct word_stats_file *self)
+{
+	unmap_file(&self->file);
+}
+
+/*
+ * Opens the .stats of a dictionary when there is one with a record per word,
+ * computed from the same dictionary files.
+ */
+int open_dictionary_stats(struct word_stats_file *self, const char *base_filename,
+	size_t num_words)
+{
+	char *filename = concatenate(base_filename, ".stats");
+	struct dictionary_fingerprint fingerprint;
+	int err = 1;
+
+	if (filename == NULL || !file_exists(filename))
+		goto out;
+	if (open_word_stats(self, filename) != 0) {
+		fprintf(stderr, "Ignoring the invalid word statistics: %s\n", filename);
+		goto out;
+	}
+	if (self->header->num_words != num_words) {
+		fprintf(stderr, "Ignoring the word statistics of another dictionary: %s\n", filename);
+		close_word_stats(self);
+		goto out;
+	}
+	if (fingerprint_dictionary(base_filename, &fingerprint) != 0 ||
+			!same_dictionary(&self->header->fingerprint, &fingerprint)) {
+		fprintf(stderr, "Ignoring the word statistics of an older dictionary, "
+			"rebuild them with indexer: %s\n", filename);
+		close_word_stats(self);
+		goto out;
+	}
+	err = 0;
+out:
+	free(filename);
+	return err;
+}
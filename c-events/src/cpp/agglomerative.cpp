@@ -0,0 +1,45 @@
+#include "agglomerative.h"
+
+using namespace std;
+
+static bool closer(const merge_step &x, const merge_step &y)
+{
+	return x.distance < y.distance;
+}
+
+static size_t find_root(vector<size_t> &roots, size_t x)
+{
+	while (roots[x] != x) {
+		roots[x] = roots[roots[x]];
+		x = roots[x];
+	}
+	return x;
+}
+
+/*
+ * Sorts the merges by distance, which for reducible linkages is an order
+ * they could have happened in, and numbers the clusters they make from n on.
+ * Then parents[c] is the cluster that c was merged into, or -1.
+ */
+void merges_to_parents(size_t n, vector<merge_step> &merges, vector<int> &parents)
+{
+	vector<size_t> roots(n);
+	vector<size_t> labels(n);
+
+	stable_sort(merges.begin(), merges.end(), closer);
+	parents.assign(n + merges.size(), -1);
+	for (size_t i = 0; i < n; i++) {
+		roots[i] = i;
+		labels[i] = i;
+	}
+
+	for (size_t i = 0; i < merges.size(); i++) {
+		const size_t x = find_root(roots, merges[i].x);
+		const size_t y = find_root(roots, merges[i].y);
+		const size_t label = n + i;
+		parents[labels[x]] = (int) label;
+		parents[labels[y]] = (int) label;
+		roots[y] = x;
+		labels[x] = label;
+	}
+}
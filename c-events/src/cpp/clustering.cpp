@@ -1,207 +1,294 @@
 #include <algorithm>
-#include <limits>
-#include <map>
-#include <set>
 #include <vector>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <pthread.h>
+#include <unistd.h>
+#include "agglomerative.h"
 #include "dictionary_reader.h"
-
-#define MAX_NUM_WORDS 250000
-#define BUFFER_SIZE 5000
+#include "sparse_relevance.h"
+#include "util.h"
+#include "word_clustering.h"
 
 using namespace std;
 
-int counts[MAX_YEARS][MAX_NUM_WORDS];
-int year_sum[MAX_YEARS];
-float relevance[MAX_YEARS][MAX_NUM_WORDS];
-float dist[2 * MAX_YEARS - 1][2 * MAX_YEARS - 1];
-int parent[2 * MAX_YEARS - 1];
+enum run_kind {
+	RUN_COMPLETE,
+	RUN_SINGLE,
+	RUN_AVERAGE,
+	RUN_WORDS,
+};
 
-bool entry_compare(const pair<float, int> &x, const pair<float, int> &y)
-{
-	if (x.first != y.first)
-		return x.first > y.first;
-	return x.second < y.second;
-}
+static const char *run_kind_names[] = { "complete", "single", "average", "words" };
+
+/* What runs on the relevance files when none are given */
+static const char *default_names[] = {
+	"double_change",
+	"linear_model",
+	"s1_gaussian",
+	"s2_gaussian",
+	"s3_gaussian",
+	"sinf_gaussian",
+	"numerical_discrepancy",
+	"kleinberg",
+};
+
+/*
+ * A relevance matrix shared by all the runs on it: the first one to start
+ * decodes it and the last one to finish releases it.
+ */
+struct clustering_input {
+	string name;
+	pthread_mutex_t lock;
+	bool loaded, valid;
+	size_t num_pending;
+	sparse_relevance matrix;
+	vector<float> gram;
+};
 
-static int square(int x)
+struct clustering_run {
+	clustering_input *input;
+	run_kind kind;
+};
+
+struct run_queue {
+	pthread_mutex_t lock;
+	size_t next;
+	size_t num_workers;
+	vector<clustering_run> runs;
+};
+
+static bool is_empty_year(const vector<float> &gram, size_t n, size_t x)
 {
-	return x * x;
+	return !(gram[x * n + x] > 0.0f);
 }
 
-float cosine_similarity(int x, int y, int num_words)
+float cosine_similarity(const vector<float> &gram, size_t n, size_t x, size_t y)
 {
-	float sum = 0.0f;
-	for (int j = 0; j < num_words; j++)
-		sum += relevance[x][j] * relevance[y][j];
-	return sum;
+	return gram[x * n + y];
 }
 
-bool multi_erase(multimap<float, int> &mm, float key, int value)
+template<class linkage>
+void cluster_years(const clustering_input &input, const char *out_filename)
 {
-	multimap<float, int>::iterator it = mm.find(key);
-	while (it != mm.end() && it->first == key && it->second != value) {
-		++it;
-	}
-	if (it != mm.end() && it->first == key && it->second == value) {
-		mm.erase(it);
-		return true;
-	} else {
-		return false;
-	}
+	FILE *f;
+	const vector<float> &gram = input.gram;
+	const size_t n = input.matrix.num_cols;
+	vector<merge_step> merges;
+	vector<int> parent;
+
+	/* Empty years stay at distance 1 from everything and are never merged */
+	condensed_matrix dist(MAX_YEARS, 1.0f);
+	for (size_t i = 0; i < MAX_YEARS; i++)
+		if (!is_empty_year(gram, n, i)) {
+			for (size_t j = i + 1; j < MAX_YEARS; j++)
+				if (!is_empty_year(gram, n, j)) {
+					float sim = cosine_similarity(gram, n, i, j);
+					sim = max(min(sim, 1.0f), 0.0f);
+					dist(i, j) = 1 - sim;
+				}
+		}
+
+	nn_chain_cluster<linkage>(dist, 1.0f, merges);
+	merges_to_parents(MAX_YEARS, merges, parent);
+
+	f = fopen(out_filename, "wt");
+	if (f == NULL)
+		return;
+
+	for (size_t i = 0; i < parent.size(); i++)
+		fprintf(f, "%zu,%d\n", i, parent[i]);
+
+	fclose(f);
 }
 
-void process_relevance(const char *in_filename, const char *out_filename)
+void cluster_input_words(const clustering_input &input, size_t num_threads,
+	const char *out_filename)
 {
 	FILE *f;
-	char *p;
-	int num_words;
-	vector<int> year_index[MAX_YEARS];
-	vector< pair<float, int> > year_reverse[MAX_YEARS];
-	char str[BUFFER_SIZE + 2];
+	word_clustering_options options;
+	vector<uint32_t> clusters;
+
+	default_word_clustering_options(options);
+	options.num_threads = max(options.num_threads / num_threads, (size_t) 1);
+	cluster_words(input.matrix, options, clusters);
 
-	f = fopen(in_filename, "rt");
+	f = fopen(out_filename, "wt");
 	if (f == NULL)
 		return;
+	write_word_clusters(f, clusters);
+	fclose(f);
+}
 
-	num_words = 0;
-	while (fgets(str, BUFFER_SIZE + 2, f) != NULL) {
-		int i = 0;
-		p = strtok(str, ",");
-		while (p != NULL) {
-			counts[i][num_words] = atoi(p);
-			p = strtok(NULL, ",");
-			i++;
-		}
-		num_words++;
-	}
+/* Prefers the binary matrix written by relevance over the CSV */
+static void load_input(clustering_input &input)
+{
+	const string base = "data/relevance/" + input.name;
+	const string in_filename = base + (file_exists((base + ".csr").c_str()) ? ".csr" : ".csv");
 
-	fclose(f);
+	input.loaded = true;
+	input.valid = read_sparse_relevance(in_filename.c_str(), input.matrix) == 0;
+	if (!input.valid)
+		return;
+	if (input.matrix.num_cols < MAX_YEARS)
+		input.matrix.num_cols = MAX_YEARS;
+	year_gram_matrix(input.matrix, input.gram);
+	printf("%s: %zu words, %zu nonzeros\n", in_filename.c_str(), input.matrix.num_rows,
+		input.matrix.indices.size());
+}
 
-	for (int i = 0; i < MAX_YEARS; i++) {
-		int sum = 0;
-		for (int j = 0; j < num_words; j++)
-			sum += square(counts[i][j]);
-		year_sum[i] = sum;
-		float length = sqrt(sum);
-		for (int j = 0; j < num_words; j++)
-			relevance[i][j] = (float) counts[i][j] / length;
-	}
+static bool acquire_input(clustering_input &input)
+{
+	pthread_mutex_lock(&input.lock);
+	if (!input.loaded)
+		load_input(input);
+	pthread_mutex_unlock(&input.lock);
+	return input.valid;
+}
 
-	for (int i = 0; i < MAX_YEARS; i++) {
-		for (int j = 0; j < num_words; j++)
-			if (counts[i][j] > 0) {
-				year_index[i].push_back(j);
-				year_reverse[i].push_back(pair<float, int>(relevance[i][j], j));
-			}
-		sort(year_reverse[i].begin(), year_reverse[i].end(), entry_compare);
-		//printf("year=%d length=%zu\n", 1500 + i, year_reverse[i].size());
+static void release_input(clustering_input &input)
+{
+	pthread_mutex_lock(&input.lock);
+	if (--input.num_pending == 0) {
+		sparse_relevance empty = sparse_relevance();
+		swap(input.matrix, empty);
+		vector<float>().swap(input.gram);
 	}
+	pthread_mutex_unlock(&input.lock);
+}
 
-	fill(parent, parent + 2 * MAX_YEARS - 1, -1);
-
-	set<int> relevant_years;
-	for (int i = 0; i < MAX_YEARS; i++)
-		if (year_sum[i] > 0)
-			relevant_years.insert(i);
-	//printf("# relevant years: %zu\n", relevant_years.size());
+/* Complete linkage keeps the name the clusters always had */
+static string output_filename(const clustering_run &run)
+{
+	const string base = "data/clusters/" + run.input->name;
 
-	for (int i = 0; i < 2 * MAX_YEARS - 1; i++)
-		for (int j = 0; j < 2 * MAX_YEARS - 1; j++)
-			dist[i][j] = 1.0f;
+	if (run.kind == RUN_COMPLETE)
+		return base + ".csv";
+	return base + "_" + run_kind_names[run.kind] + ".csv";
+}
 
-	set<int> nodes;
-	for (int j = 0; j < num_words; j++)
-		nodes.insert(j);
+static void execute_run(const clustering_run &run, size_t num_workers)
+{
+	const string out_filename = output_filename(run);
 
-	multimap<float, int> pq[2 * MAX_YEARS - 1];
+	switch (run.kind) {
+	case RUN_COMPLETE:
+		cluster_years<complete_linkage>(*run.input, out_filename.c_str());
+		break;
+	case RUN_SINGLE:
+		cluster_years<single_linkage>(*run.input, out_filename.c_str());
+		break;
+	case RUN_AVERAGE:
+		cluster_years<average_linkage>(*run.input, out_filename.c_str());
+		break;
+	case RUN_WORDS:
+		cluster_input_words(*run.input, num_workers, out_filename.c_str());
+		break;
+	}
+}
 
-	for (int i = 0; i < MAX_YEARS; i++)
-		if (year_sum[i] > 0) {
-			for (int j = i + 1; j < MAX_YEARS; j++)
-				if (year_sum[j] > 0) {
-					float sim = cosine_similarity(i, j, num_words);
-					sim = max(min(sim, 1.0f), 0.0f);
-					dist[i][j] = 1 - sim;
-					pq[i].insert(pair<float, int>(dist[i][j], j));
-				}
-		}
+static void *run_worker(void *arg)
+{
+	run_queue &queue = *(run_queue *) arg;
 
-	int k = MAX_YEARS;
-	for (; ; k++) {
-		int mx = -1, my = -1;
-		float min_dist = numeric_limits<float>::max();
-		for (int i = 0; i < k; i++)
-			if (!pq[i].empty()) {
-				multimap<float, int>::const_iterator it = pq[i].begin();
-				float cand_dist = it->first;
-				if (cand_dist < min_dist) {
-					min_dist = cand_dist;
-					mx = i;
-					my = it->second;
-				}
-			}
-		//fprintf(stderr, "k=%d (%d, %d) %f\n", k - MAX_YEARS, mx, my, min_dist);
-		if (mx == -1 || my == -1)
+	for (;;) {
+		pthread_mutex_lock(&queue.lock);
+		const size_t i = queue.next++;
+		pthread_mutex_unlock(&queue.lock);
+		if (i >= queue.runs.size())
 			break;
 
-		parent[mx] = k;
-		parent[my] = k;
-		for (int i = 0; i < k; i++)
-			if (parent[i] < 0) {
-#if 0
-				float new_dist = numeric_limits<float>::max();
-				if (i < mx)
-					new_dist = min(new_dist, dist[i][mx]);
-				else
-					new_dist = min(new_dist, dist[mx][i]);
-				if (i < my)
-					new_dist = min(new_dist, dist[i][my]);
-				else
-					new_dist = min(new_dist, dist[my][i]);
-#else
-				float new_dist = -numeric_limits<float>::max();
-				if (i < mx)
-					new_dist = max(new_dist, dist[i][mx]);
-				else
-					new_dist = max(new_dist, dist[mx][i]);
-				if (i < my)
-					new_dist = max(new_dist, dist[i][my]);
-				else
-					new_dist = max(new_dist, dist[my][i]);
-#endif
-				if (new_dist < 1.0f) {
-					dist[i][k] = new_dist;
-					pq[i].insert(pair<float, int>(new_dist, k));
-				}
-			}
-
-		pq[mx].clear();
-		for (int i = 0; i < mx; i++)
-			multi_erase(pq[i], dist[i][mx], mx);
-		pq[my].clear();
-		for (int i = 0; i < my; i++)
-			multi_erase(pq[i], dist[i][my], my);
+		const clustering_run &run = queue.runs[i];
+		if (acquire_input(*run.input))
+			execute_run(run, queue.num_workers);
+		release_input(*run.input);
 	}
+	return NULL;
+}
 
-	f = fopen(out_filename, "wt");
-	if (f == NULL)
-		return;
+static clustering_input *find_input(vector<clustering_input *> &inputs, const string &name)
+{
+	for (size_t i = 0; i < inputs.size(); i++)
+		if (inputs[i]->name == name)
+			return inputs[i];
 
-	for (int i = 0; i < k; i++)
-		fprintf(f, "%d,%d\n", i, parent[i]);
+	clustering_input *input = new clustering_input();
+	input->name = name;
+	pthread_mutex_init(&input->lock, NULL);
+	input->loaded = false;
+	input->valid = false;
+	input->num_pending = 0;
+	inputs.push_back(input);
+	return input;
+}
 
-	fclose(f);
+/* Parses name[:linkage], where the linkage may also be words */
+static int add_run(run_queue &queue, vector<clustering_input *> &inputs, const string &spec)
+{
+	const size_t colon = spec.find(':');
+	clustering_run run;
+
+	run.kind = RUN_COMPLETE;
+	if (colon != string::npos) {
+		const string kind = spec.substr(colon + 1);
+		size_t k = 0;
+		while (k < sizeof(run_kind_names) / sizeof(*run_kind_names) && kind != run_kind_names[k])
+			k++;
+		if (k == sizeof(run_kind_names) / sizeof(*run_kind_names))
+			return -1;
+		run.kind = (run_kind) k;
+	}
+
+	run.input = find_input(inputs, spec.substr(0, colon));
+	run.input->num_pending++;
+	queue.runs.push_back(run);
+	return 0;
 }
 
-int main()
+/*
+ * Usage: clustering [name[:complete|single|average|words]]...
+ * Clusters data/relevance/<name> into data/clusters, with one thread per
+ * processor working through the runs. Without arguments, every relevance
+ * file gets its complete linkage years and its words clustered.
+ */
+int main(int argc, char **argv)
 {
-	printf("%zu KB\n", sizeof(relevance) >> 10);
-	process_relevance("data/relevance/double_change.csv", "data/clusters/double_change.csv");
-	process_relevance("data/relevance/linear_model.csv", "data/clusters/linear_model.csv");
-	process_relevance("data/relevance/gaussian_model.csv", "data/clusters/gaussian_model.csv");
+	run_queue queue;
+	vector<clustering_input *> inputs;
+	vector<pthread_t> threads;
+	long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (argc > 1) {
+		for (int i = 1; i < argc; i++)
+			if (add_run(queue, inputs, argv[i]) != 0) {
+				fprintf(stderr, "clustering: unknown linkage in %s\n", argv[i]);
+				return 1;
+			}
+	} else {
+		for (size_t i = 0; i < sizeof(default_names) / sizeof(*default_names); i++) {
+			add_run(queue, inputs, default_names[i]);
+			add_run(queue, inputs, string(default_names[i]) + ":words");
+		}
+	}
+
+	pthread_mutex_init(&queue.lock, NULL);
+	queue.next = 0;
+	queue.num_workers = min(num_cpus > 0 ? (size_t) num_cpus : 1, queue.runs.size());
+	threads.resize(queue.num_workers);
+	for (size_t t = 1; t < threads.size(); t++)
+		if (pthread_create(&threads[t], NULL, run_worker, &queue) != 0)
+			threads.resize(t);
+	run_worker(&queue);
+	for (size_t t = 1; t < threads.size(); t++)
+		pthread_join(threads[t], NULL);
+
+	for (size_t i = 0; i < inputs.size(); i++) {
+		pthread_mutex_destroy(&inputs[i]->lock);
+		delete inputs[i];
+	}
+	pthread_mutex_destroy(&queue.lock);
 	return 0;
 }
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "dictionary_reader.h"
+#include "dictionary_types.h"
+#include "synthetic_series.h"
+#include "util.h"
+
+#define SHARD_PREFIX "googlebooks-eng-all-1gram-20120701-synthetic-"
+#define TOTAL_COUNTS_FILENAME "googlebooks-eng-all-totalcounts-20120701.txt"
+#define MAX_BURSTS 3
+
+using namespace std;
+
+/* Close to the counts of the 2012 release: 3e4 matches in 1505, 2e10 in 2008 */
+#define FIRST_YEAR_MATCHES 1e4
+#define LAST_YEAR_MATCHES 2e10
+/* And of the volumes: a single book in 1505, about 2e5 in 2008 */
+#define FIRST_YEAR_VOLUMES 1.0
+#define LAST_YEAR_VOLUMES 2e5
+
+struct corpus_options {
+	size_t num_words;
+	size_t num_shards;
+	unsigned int seed;
+	double zipf_exponent;
+	double burst_fraction;
+	double scale;
+	const char *directory;
+};
+
+struct burst {
+	double center, sigma, height;
+};
+
+static const char *syllables[] = {
+	"a", "an", "ar", "ba", "be", "ca", "con", "de", "di", "el", "en", "er", "ex", "fa",
+	"ga", "he", "in", "is", "ka", "la", "le", "li", "ma", "me", "mo", "na", "ne", "no",
+	"or", "pa", "per", "pro", "ra", "re", "ri", "sa", "se", "so", "ta", "te", "ti", "to",
+	"un", "va", "ve", "wa", "ya", "zo",
+};
+
+/*
+ * The word of a frequency rank: the rank in bijective base-48 syllables, so
+ * that every rank gets its own word and the frequent ones are short. One in
+ * sixteen gets a part-of-speech tag, as in the 2012 release.
+ */
+static void rank_word(size_t rank, string &word)
+{
+	const size_t num_syllables = sizeof(syllables) / sizeof(*syllables);
+	size_t n = rank + 1;
+
+	word.clear();
+	while (n > 0) {
+		n--;
+		word += syllables[n % num_syllables];
+		n /= num_syllables;
+	}
+	if (rank % 16 == 15)
+		word += "_NOUN";
+}
+
+static double normal_sample()
+{
+	return sqrt(-2.0 * log(uniform_sample())) * cos(2.0 * M_PI * uniform_sample());
+}
+
+/* The matches of the whole corpus, growing exponentially over the years */
+static double year_matches(size_t year_index, double scale)
+{
+	const double growth = log(LAST_YEAR_MATCHES / FIRST_YEAR_MATCHES) / (MAX_YEARS - 1);
+
+	return scale * FIRST_YEAR_MATCHES * exp(growth * (double) year_index);
+}
+
+/* The volumes of the whole corpus, growing the same way, at least one */
+static unsigned long long year_volumes(size_t year_index, double scale)
+{
+	const double growth = log(LAST_YEAR_VOLUMES / FIRST_YEAR_VOLUMES) / (MAX_YEARS - 1);
+	const double volumes = scale * FIRST_YEAR_VOLUMES * exp(growth * (double) year_index);
+
+	return max(1ULL, (unsigned long long) (volumes + 0.5));
+}
+
+/* The volume and page counts are read with atoi, into 32-bit fields */
+static unsigned long long clamp_count(unsigned long long count)
+{
+	return min(count, (unsigned long long) INT_MAX);
+}
+
+static int parse_options(struct corpus_options *options, int argc, char **argv)
+{
+	for (int i = 1; i < argc; i += 2) {
+		const char *option = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing the value of: %s\n", option);
+			return 1;
+		}
+		const char *value = argv[i + 1];
+		if (strcmp(option, "--words") == 0)
+			options->num_words = strtoul(value, NULL, 10);
+		else if (strcmp(option, "--shards") == 0)
+			options->num_shards = max(strtoul(value, NULL, 10), 1UL);
+		else if (strcmp(option, "--seed") == 0)
+			options->seed = (unsigned int) strtoul(value, NULL, 10);
+		else if (strcmp(option, "--zipf") == 0)
+			options->zipf_exponent = atof(value);
+		else if (strcmp(option, "--bursts") == 0)
+			options->burst_fraction = atof(value);
+		else if (strcmp(option, "--scale") == 0)
+			options->scale = atof(value);
+		else if (strcmp(option, "--output") == 0)
+			options->directory = value;
+		else {
+			fprintf(stderr, "Unknown option: %s\n", option);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Writes the lines of one word, from the year it appears until the last
+ * one: its Zipfian share of every year's matches, raised by its bursts and
+ * with lognormal noise, rounded at random. Years without a match are left
+ * out, as in the release. The volume count is the expected number of the
+ * year's volumes holding the matches, which come in clumps of a few per
+ * volume, so it never exceeds the matches or the volumes of the year.
+ * Returns the number of lines.
+ */
+static size_t write_word(FILE *f, const string &word, double share, size_t first_year,
+	const vector<burst> &bursts, const struct corpus_options *options,
+	vector<unsigned long long> &matches, const vector<unsigned long long> &volumes)
+{
+	const double clump_size = 1.0 + 19.0 * uniform_sample();
+	size_t num_lines = 0;
+
+	for (size_t y = first_year; y < MAX_YEARS; y++) {
+		double expected = year_matches(y, options->scale) * share;
+		for (size_t b = 0; b < bursts.size(); b++) {
+			const double z = ((double) y - bursts[b].center) / bursts[b].sigma;
+			expected *= 1.0 + bursts[b].height * exp(-0.5 * z * z);
+		}
+		expected *= exp(0.2 * normal_sample());
+
+		const unsigned long long match_count = (unsigned long long) (expected + uniform_sample());
+		if (match_count == 0)
+			continue;
+		const double year_volume_count = (double) volumes[y];
+		const double expected_volumes = -year_volume_count *
+			expm1(-(double) match_count / (clump_size * year_volume_count));
+		const unsigned long long volume_count = clamp_count(max(1ULL,
+			min(volumes[y], (unsigned long long) (expected_volumes + uniform_sample()))));
+		fprintf(f, "%s\t%u\t%llu\t%llu\n", word.c_str(), (unsigned int) (MIN_YEAR + y),
+			match_count, volume_count);
+		matches[y] += match_count;
+		num_lines++;
+	}
+	return num_lines;
+}
+
+/* One line of year,match_count,page_count,volume_count entries, as in the release */
+static int write_total_counts(const string &filename, const vector<unsigned long long> &matches,
+	const vector<unsigned long long> &volumes)
+{
+	FILE *f = fopen(filename.c_str(), "wt");
+	bool first = true;
+	int err = 0;
+
+	if (f == NULL) {
+		fprintf(stderr, "Could not open for writing: %s\n", filename.c_str());
+		return 1;
+	}
+	for (size_t y = 0; y < MAX_YEARS; y++) {
+		if (matches[y] == 0)
+			continue;
+		if (fprintf(f, "%s%u,%llu,%llu,%llu", first ? " " : "\t", (unsigned int) (MIN_YEAR + y),
+				matches[y], clamp_count(matches[y] / 250 + 1), clamp_count(volumes[y])) < 0)
+			err = 1;
+		first = false;
+	}
+	fprintf(f, "\n");
+	if (fclose(f) != 0)
+		err = 1;
+	return err;
+}
+
+/*
+ * Usage: corpus_generator [--words N] [--shards N] [--seed N] [--zipf S]
+ *	[--bursts FRACTION] [--scale FACTOR] [--output DIRECTORY]
+ * Writes a corpus shaped like the 2012 English 1-grams under DIRECTORY/data,
+ * synthetic/data by default: the tab-separated shards which csv_parser
+ * reads in csv/, the total counts and bursts.tsv, the ground truth of the
+ * injected bursts (word, center year, sigma in years and height relative
+ * to the word's usual frequency). The same options always give the same
+ * corpus. --scale multiplies every count, --words the vocabulary.
+ */
+int main(int argc, char **argv)
+{
+	struct corpus_options options = { 100000, 10, 2012, 1.07, 0.05, 1.0, "synthetic" };
+	vector<unsigned long long> matches(MAX_YEARS, 0), volumes(MAX_YEARS, 0);
+	vector<FILE *> shards;
+	vector<burst> bursts;
+	FILE *truth = NULL;
+	string word;
+	double harmonic = 0.0;
+	unsigned long long num_lines = 0;
+	char name[32];
+	int err = 0;
+
+	if (parse_options(&options, argc, argv) != 0)
+		return EXIT_FAILURE;
+
+	const string data_directory = string(options.directory) + "/data/";
+	const string csv_directory = data_directory + "csv/";
+	make_directory(options.directory);
+	make_directory(data_directory.c_str());
+	make_directory(csv_directory.c_str());
+
+	for (size_t i = 0; i < options.num_shards; i++) {
+		snprintf(name, sizeof(name), "%03lu", (unsigned long) i);
+		const string filename = csv_directory + SHARD_PREFIX + name;
+		FILE *f = fopen(filename.c_str(), "wt");
+		if (f == NULL) {
+			fprintf(stderr, "Could not open for writing: %s\n", filename.c_str());
+			err = 1;
+			goto out_files;
+		}
+		shards.push_back(f);
+	}
+	truth = fopen((data_directory + "bursts.tsv").c_str(), "wt");
+	if (truth == NULL) {
+		fprintf(stderr, "Could not open for writing: %sbursts.tsv\n", data_directory.c_str());
+		err = 1;
+		goto out_files;
+	}
+	fprintf(truth, "word\tcenter\tsigma\theight\n");
+
+	for (size_t rank = 0; rank < options.num_words; rank++)
+		harmonic += pow((double) rank + 1.0, -options.zipf_exponent);
+	for (size_t y = 0; y < MAX_YEARS; y++)
+		volumes[y] = year_volumes(y, options.scale);
+
+	seed_synthetic(options.seed);
+	for (size_t rank = 0; rank < options.num_words; rank++) {
+		const double share = pow((double) rank + 1.0, -options.zipf_exponent) / harmonic;
+		/* Frequent words go back further, rare ones mostly appear late */
+		const double rarity = log((double) rank + 1.0) / log((double) options.num_words + 1.0);
+		const size_t first_year = (size_t) ((MAX_YEARS - 50) * rarity * sqrt(uniform_sample()));
+
+		rank_word(rank, word);
+		bursts.clear();
+		if (uniform_sample() < options.burst_fraction) {
+			const size_t num_bursts = 1 + (size_t) (MAX_BURSTS * uniform_sample());
+			for (size_t b = 0; b < num_bursts; b++) {
+				burst event;
+				event.center = (double) first_year + 10.0 +
+					(MAX_YEARS - 15.0 - (double) first_year) * uniform_sample();
+				event.sigma = 1.0 + 14.0 * uniform_sample();
+				event.height = 2.0 + 18.0 * uniform_sample();
+				bursts.push_back(event);
+				fprintf(truth, "%s\t%.2f\t%.2f\t%.2f\n", word.c_str(), MIN_YEAR + event.center,
+					event.sigma, event.height);
+			}
+		}
+		num_lines += write_word(shards[rank % options.num_shards], word, share, first_year,
+			bursts, &options, matches, volumes);
+	}
+
+	err = write_total_counts(data_directory + TOTAL_COUNTS_FILENAME, matches, volumes);
+	printf("Wrote %llu lines of %lu words in %lu shards under %s\n", num_lines,
+		(unsigned long) options.num_words, (unsigned long) options.num_shards,
+		data_directory.c_str());
+
+out_files:
+	if (truth != NULL && fclose(truth) != 0)
+		err = 1;
+	for (size_t i = 0; i < shards.size(); i++) {
+		if (fclose(shards[i]) != 0) {
+			fprintf(stderr, "Could not write the %luth shard\n", (unsigned long) i);
+			err = 1;
+		}
+	}
+	return err;
+}
@@ -0,0 +1,400 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "dictionary_reader.h"
+#include "double_change.h"
+#include "gaussian_finder.h"
+#include "gaussian_model.h"
+#include "kleinberg.h"
+#include "linear_model.h"
+#include "numerical_discrepancy.h"
+#include "series.h"
+#include "synthetic_series.h"
+#include "util.h"
+#include "word_selection.h"
+
+#define NUM_SERIES 1024
+#define MIN_SECONDS 0.2
+#define SMOOTHING_WINDOW 2
+#define DOCS_PER_YEAR 100000
+
+using namespace std;
+
+/*
+ * Every allocation of the process goes through these, shared libraries
+ * included, so that the detectors can be charged for their allocations.
+ */
+#ifdef __GLIBC__
+static unsigned long long num_allocations = 0;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+
+void *malloc(size_t size)
+{
+	num_allocations++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	num_allocations++;
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+	num_allocations++;
+	return __libc_realloc(p, size);
+}
+
+void free(void *p)
+{
+	__libc_free(p);
+}
+}
+
+static unsigned long long count_allocations()
+{
+	return num_allocations;
+}
+#else
+static unsigned long long count_allocations()
+{
+	return 0;
+}
+#endif
+
+/* The series of one family, raw and smoothed as process smooths them */
+struct series_family {
+	string name;
+	size_t num_words;
+	vector<double> raw, smooth;
+	vector<unsigned int> relevant;
+};
+
+struct benchmark_context {
+	vector<unsigned int> docs;
+	vector<unsigned int> relevant;
+	double scratch[MAX_YEARS];
+	int counts[MAX_YEARS];
+	struct static_range training_data;
+	gsl_multimin_function_fdf regression_func;
+	discrepancy_workspace workspace;
+	vector<gaussian_entry> gaussians;
+	vector< vector<gaussian_entry> > selected;
+	vector< pair<size_t, int> > relevant_counts;
+	vector<size_t> hidden_states;
+};
+
+/* Each detector handles one word and returns how many events it found */
+typedef size_t (*detector_f)(benchmark_context &context, const series_family &family, size_t word);
+
+struct detector {
+	const char *name;
+	detector_f run;
+	size_t max_words;
+};
+
+static size_t run_smoothify(benchmark_context &context, const series_family &family, size_t word)
+{
+	smoothify_series(&family.raw[word * MAX_YEARS], context.scratch, MAX_YEARS, SMOOTHING_WINDOW);
+	return 0;
+}
+
+/* The scoring of process_series_double_change, without the summary */
+static size_t run_double_change(benchmark_context &context, const series_family &family, size_t word)
+{
+	size_t num_events = 0;
+
+	double_change_scores(&family.smooth[word * MAX_YEARS], context.counts);
+	for (int j = 2; j < MAX_YEARS - 2; j++)
+		num_events += context.counts[j] > 0;
+	return num_events;
+}
+
+/* normalize_generate_ranges, on a copy since it standardizes the series in place */
+static size_t run_generate_ranges(benchmark_context &context, const series_family &family, size_t word)
+{
+	struct static_array ranges;
+
+	memcpy(context.scratch, &family.smooth[word * MAX_YEARS], sizeof(context.scratch));
+	normalize_generate_ranges(&ranges, gsl_multimin_fdfminimizer_conjugate_pr,
+		&context.regression_func);
+	return ranges.size;
+}
+
+static size_t run_select_gaussians(benchmark_context &context, const series_family &family, size_t word)
+{
+	select_gaussians(&family.smooth[word * MAX_YEARS], SMOOTHING_WINDOW,
+		MAX_YEARS - SMOOTHING_WINDOW, context.gaussians);
+	return context.gaussians.size();
+}
+
+/* Widens the Gaussians which select_gaussians found for the word beforehand */
+static size_t run_relevant_gaussians(benchmark_context &context, const series_family &, size_t word)
+{
+	context.relevant_counts.clear();
+	relevant_gaussians(context.selected[word], context.relevant_counts, 2.0);
+	return context.relevant_counts.size();
+}
+
+static size_t run_fit_discrepancy(benchmark_context &context, const series_family &family, size_t word)
+{
+	context.workspace.intervals.clear();
+	fit_discrepancy(&family.smooth[word * MAX_YEARS], SMOOTHING_WINDOW, context.workspace,
+		context.workspace.intervals);
+	return context.workspace.intervals.size();
+}
+
+static size_t run_batch_viterbi(benchmark_context &context, const series_family &family, size_t word)
+{
+	size_t num_events = 0;
+
+	context.relevant.assign(family.relevant.begin() + (ptrdiff_t) (word * MAX_YEARS),
+		family.relevant.begin() + (ptrdiff_t) ((word + 1) * MAX_YEARS));
+	context.hidden_states.clear();
+	if (!batch_viterbi(context.docs, context.relevant, context.hidden_states))
+		return 0;
+	for (size_t i = 0; i < context.hidden_states.size(); i++)
+		num_events += context.hidden_states[i] > 0;
+	return num_events;
+}
+
+static double elapsed_seconds(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/*
+ * Runs the detector over the words of the family once to warm up, then in
+ * as many rounds as it takes to last MIN_SECONDS, and reports the time and
+ * allocations per word along with the events per word, which change only
+ * when the detector's results do.
+ */
+static void run_detector(benchmark_context &context, const series_family &family,
+	const detector &d, FILE *csv)
+{
+	const size_t num_words = min(family.num_words, d.max_words);
+	size_t num_events = 0, num_rounds = 0;
+	unsigned long long num_allocated;
+	double seconds;
+	clock_t start;
+
+	if (num_words == 0)
+		return;
+	for (size_t i = 0; i < num_words; i++)
+		d.run(context, family, i);
+
+	num_allocated = count_allocations();
+	start = clock();
+	do {
+		num_events = 0;
+		for (size_t i = 0; i < num_words; i++)
+			num_events += d.run(context, family, i);
+		num_rounds++;
+		seconds = elapsed_seconds(start);
+	} while (seconds < MIN_SECONDS);
+	num_allocated = count_allocations() - num_allocated;
+
+	const double num_calls = (double) num_words * (double) num_rounds;
+	printf("%-14s %-18s %10.1f ns/word %8.2f allocations/word %8.2f events/word\n",
+		family.name.c_str(), d.name, 1e9 * seconds / num_calls,
+		(double) num_allocated / num_calls, (double) num_events / (double) num_words);
+	if (csv != NULL)
+		fprintf(csv, "%s,%s,%lu,%lu,%.1f,%.3f,%.3f\n", family.name.c_str(), d.name,
+			(unsigned long) num_words, (unsigned long) num_rounds, 1e9 * seconds / num_calls,
+			(double) num_allocated / num_calls, (double) num_events / (double) num_words);
+}
+
+/* The match counts which the relevant documents of Kleinberg's model come from */
+static void fill_relevant(series_family &family, const vector<unsigned int> &docs)
+{
+	family.relevant.resize(family.raw.size());
+	for (size_t i = 0; i < family.raw.size(); i++) {
+		const double count = family.raw[i] * docs[i % MAX_YEARS] / 100.0;
+		family.relevant[i] = (unsigned int) min(count + 0.5, (double) docs[i % MAX_YEARS]);
+	}
+}
+
+static void smooth_family(series_family &family)
+{
+	family.smooth.resize(family.raw.size());
+	for (size_t i = 0; i < family.num_words; i++)
+		smoothify_series(&family.raw[i * MAX_YEARS], &family.smooth[i * MAX_YEARS], MAX_YEARS,
+			SMOOTHING_WINDOW);
+}
+
+static void add_synthetic_families(vector<series_family> &families)
+{
+	const char *names[] = { "flat", "spike", "gaussian_bump", "step", "multi_burst" };
+
+	for (size_t f = 0; f < sizeof(names) / sizeof(*names); f++) {
+		series_family family;
+		family.name = names[f];
+		family.num_words = NUM_SERIES;
+		family.raw.resize(NUM_SERIES * MAX_YEARS);
+		for (size_t i = 0; i < NUM_SERIES; i++) {
+			double *series = &family.raw[i * MAX_YEARS];
+			const double level = pareto_sample(1e-3, 2.0);
+			if (f == 0)
+				flat_series(series, MAX_YEARS, level);
+			else if (f == 1)
+				spike_series(series, MAX_YEARS, level);
+			else if (f == 2)
+				gaussian_bump_series(series, MAX_YEARS, level);
+			else if (f == 3)
+				step_series(series, MAX_YEARS, level);
+			else
+				multi_burst_series(series, MAX_YEARS, level, 2 + (size_t) (4.0 * uniform_sample()));
+		}
+		families.push_back(family);
+	}
+}
+
+/*
+ * Replays words of the sorted dictionary when there is one: the selected
+ * words, or the frequent ones which process summarizes by default.
+ */
+static int add_replay_family(vector<series_family> &families, struct word_selection &selection,
+	vector<unsigned int> &docs)
+{
+	const char *base_filename = "data/sort/googlebooks-eng-all-1gram-20120701-database";
+	struct dictionary_reader dict;
+	struct time_entry table[MAX_YEARS];
+	series_family family;
+	size_t *selected, num_selected, table_size;
+	int err;
+
+	if (!file_exists((string(base_filename) + ".main").c_str()))
+		return 0;
+	err = init_dictreader(&dict, base_filename);
+	if (err != 0)
+		return err;
+
+	if (is_word_selection_empty(&selection))
+		selection.min_match_count = 1 << 18;
+	err = select_words(&dict, &selection, &selected, &num_selected);
+	if (err != 0)
+		goto out_reader;
+
+	family.name = "replay";
+	family.num_words = min(num_selected, (size_t) NUM_SERIES);
+	family.raw.resize(family.num_words * MAX_YEARS);
+	for (size_t i = 0; i < family.num_words; i++) {
+		err = read_table(&dict, selected[i], table, &table_size);
+		if (err != 0)
+			goto out_selected;
+		table_to_series(&dict, table, table_size, &family.raw[i * MAX_YEARS]);
+	}
+	for (size_t i = 0; i < MAX_YEARS; i++)
+		docs[i] = match_total_counts_feature(&dict.frequencies[i]);
+	families.push_back(family);
+
+out_selected:
+	free(selected);
+out_reader:
+	destroy_dictreader(&dict);
+	return err;
+}
+
+/*
+ * Usage: detector_benchmark [--csv FILE] [--words FILE] [--regex PATTERN]
+ *	[--prefix PREFIX] [--min-count N] [--max-count N]
+ * Times every detector over synthetic families of series and, when the
+ * sorted dictionary is there, over replayed words, which the options
+ * select. --csv also writes the results as comma-separated values.
+ */
+int main(int argc, char **argv)
+{
+	const detector detectors[] = {
+		{ "smoothify_series", run_smoothify, NUM_SERIES },
+		{ "double_change", run_double_change, NUM_SERIES },
+		{ "generate_ranges", run_generate_ranges, 32 },
+		{ "select_gaussians", run_select_gaussians, 256 },
+		{ "relevant_gaussians", run_relevant_gaussians, NUM_SERIES },
+		{ "fit_discrepancy", run_fit_discrepancy, NUM_SERIES },
+		{ "batch_viterbi", run_batch_viterbi, 64 },
+	};
+	vector<char *> selection_args(1, argv[0]);
+	vector<series_family> families;
+	struct word_selection selection;
+	benchmark_context context;
+	const char *csv_filename = NULL;
+	FILE *csv = NULL;
+	unsigned int max_num_docs = 0;
+	int err;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			csv_filename = argv[++i];
+		else
+			selection_args.push_back(argv[i]);
+	}
+	init_word_selection(&selection);
+	if (parse_word_selection(&selection, (int) selection_args.size(), &selection_args[0]) != 0)
+		return EXIT_FAILURE;
+
+	/* Documents grow over the years, as the total counts do */
+	context.docs.resize(MAX_YEARS);
+	for (size_t i = 0; i < MAX_YEARS; i++)
+		context.docs[i] = (unsigned int) (DOCS_PER_YEAR * (1.0 + (double) i / 100.0));
+
+	seed_synthetic(2012);
+	add_synthetic_families(families);
+	err = add_replay_family(families, selection, context.docs);
+	if (err != 0)
+		return EXIT_FAILURE;
+
+	for (size_t f = 0; f < families.size(); f++) {
+		smooth_family(families[f]);
+		fill_relevant(families[f], context.docs);
+	}
+	for (size_t i = 0; i < MAX_YEARS; i++)
+		max_num_docs = max(max_num_docs, context.docs[i]);
+	init_partial_sums();
+	init_ln_sums(max_num_docs);
+
+	context.training_data.begin = 0;
+	context.training_data.end = MAX_YEARS;
+	context.training_data.year_offset = SMOOTHING_WINDOW;
+	context.training_data.array = context.scratch + SMOOTHING_WINDOW;
+	context.training_data.size = MAX_YEARS - 2 * SMOOTHING_WINDOW;
+	context.regression_func.n = 2;
+	context.regression_func.f = regression_f;
+	context.regression_func.df = regression_df;
+	context.regression_func.fdf = regression_fdf;
+	context.regression_func.params = &context.training_data;
+
+	if (csv_filename != NULL) {
+		csv = fopen(csv_filename, "wt");
+		if (csv == NULL) {
+			fprintf(stderr, "Could not open for writing: %s\n", csv_filename);
+			return EXIT_FAILURE;
+		}
+		fprintf(csv, "family,detector,words,rounds,ns_per_word,allocations_per_word,events_per_word\n");
+	}
+
+	for (size_t f = 0; f < families.size(); f++) {
+		const series_family &family = families[f];
+		context.selected.resize(family.num_words);
+		for (size_t i = 0; i < family.num_words; i++)
+			select_gaussians(&family.smooth[i * MAX_YEARS], SMOOTHING_WINDOW,
+				MAX_YEARS - SMOOTHING_WINDOW, context.selected[i]);
+		for (size_t d = 0; d < sizeof(detectors) / sizeof(*detectors); d++)
+			run_detector(context, family, detectors[d], csv);
+	}
+
+	if (csv != NULL && fclose(csv) != 0) {
+		fprintf(stderr, "Could not write: %s\n", csv_filename);
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
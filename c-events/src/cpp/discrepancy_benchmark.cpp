@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "dictionary_reader.h"
+#include "numerical_discrepancy.h"
+#include "series.h"
+#include "synthetic_series.h"
+
+#define NUM_SERIES 4096
+#define NUM_ROUNDS 8
+
+using namespace std;
+
+typedef vector< pair< pair<size_t, size_t>, double > > interval_vector;
+
+/*
+ * The original quadratic engine, kept as the reference for the linear one:
+ * the candidates are searched through back pointers, and long intervals are
+ * refined by re-appending to the output.
+ */
+static void reference_max_sequences(const double *v, size_t n, vector<double> &sums,
+	vector< pair<size_t, size_t> > &indices)
+{
+	vector<size_t> back_ptr;
+
+	sums.push_back(0.0);
+	for (size_t i = 0; i < n; i++)
+		sums.push_back(sums.back() + v[i]);
+
+	size_t inf_index = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (v[i] > 0) {
+			size_t si = i;
+			while (si + 1 < n && v[si + 1] > 0)
+				++si;
+			indices.push_back(make_pair(i, si));
+			back_ptr.push_back(n);
+			i = si;
+			while (true) {
+				double left = sums[indices.back().first];
+				size_t j = back_ptr.back();
+				bool found = (j < n);
+				if (!found) {
+					if (indices.size() >= inf_index + 2) {
+						for (j = indices.size() - 2; j != n; j = back_ptr[j])
+							if (sums[indices[j].first] < left) {
+								found = true;
+								back_ptr.back() = j;
+								break;
+							}
+					}
+				}
+				if (found && sums[indices[j].second + 1] < sums[indices.back().second + 1]) {
+					indices[j].second = i;
+					indices.resize(j + 1);
+					back_ptr.resize(j + 1);
+				} else {
+					if (!found)
+						inf_index = indices.size() - 1;
+					break;
+				}
+			}
+		}
+	}
+}
+
+static void reference_analyze_burstiness(const double *series, size_t num_elems,
+	vector<double> &bursty_sums, vector< pair<size_t, size_t> > &indices)
+{
+	double burstiness[MAX_YEARS];
+	double sum = 0.0;
+
+	for (size_t i = 0; i < num_elems; i++)
+		sum += series[i];
+
+	for (size_t i = 0; i < num_elems; i++)
+		burstiness[i] = series[i] / sum - 1. / num_elems;
+
+	bursty_sums.clear();
+	reference_max_sequences(burstiness, num_elems, bursty_sums, indices);
+}
+
+static void reference_append_indices(const vector< pair<size_t, size_t> > &indices,
+	interval_vector &intervals, size_t offset, const vector<double> &sums, size_t s_off)
+{
+	for (size_t i = 0; i < indices.size(); i++) {
+		pair<size_t, size_t> interval(indices[i].first + offset, indices[i].second + offset);
+		double score = sums[interval.second + 1 - s_off] - sums[interval.first - s_off];
+		intervals.push_back(make_pair(interval, score));
+	}
+}
+
+void reference_fit_discrepancy(const double *series, unsigned int smoothing_window,
+	interval_vector &intervals)
+{
+	vector< pair<size_t, size_t> > indices;
+	vector<double> sums, lesser_sums;
+
+	size_t inf = smoothing_window;
+	size_t sup = MAX_YEARS - smoothing_window;
+	reference_analyze_burstiness(series + inf, sup - inf, sums, indices);
+	reference_append_indices(indices, intervals, inf, sums, inf);
+
+	for (size_t i = 0; i < intervals.size();) {
+		size_t diff = intervals[i].first.second - intervals[i].first.first + 1;
+		if (diff >= 32) {
+			size_t sub_inf = intervals[i].first.first;
+			intervals[i] = intervals.back();
+			intervals.pop_back();
+
+			indices.clear();
+			reference_analyze_burstiness(series + sub_inf, diff, lesser_sums, indices);
+			reference_append_indices(indices, intervals, sub_inf, sums, inf);
+		} else {
+			i++;
+		}
+	}
+}
+
+double run_reference(const vector<double> &all_series, size_t &num_intervals)
+{
+	clock_t cs, ce;
+
+	num_intervals = 0;
+	cs = clock();
+	for (size_t round = 0; round < NUM_ROUNDS; round++) {
+		for (size_t i = 0; i < NUM_SERIES; i++) {
+			interval_vector intervals;
+			reference_fit_discrepancy(&all_series[i * MAX_YEARS], 2, intervals);
+			num_intervals += intervals.size();
+		}
+	}
+	ce = clock();
+
+	return (double) (ce - cs) / CLOCKS_PER_SEC;
+}
+
+double run_allocating(const vector<double> &all_series, size_t &num_intervals)
+{
+	clock_t cs, ce;
+
+	num_intervals = 0;
+	cs = clock();
+	for (size_t round = 0; round < NUM_ROUNDS; round++) {
+		for (size_t i = 0; i < NUM_SERIES; i++) {
+			interval_vector intervals;
+			fit_discrepancy(&all_series[i * MAX_YEARS], 2, intervals);
+			num_intervals += intervals.size();
+		}
+	}
+	ce = clock();
+
+	return (double) (ce - cs) / CLOCKS_PER_SEC;
+}
+
+double run_workspace(const vector<double> &all_series, size_t &num_intervals)
+{
+	discrepancy_workspace workspace;
+	clock_t cs, ce;
+
+	num_intervals = 0;
+	cs = clock();
+	for (size_t round = 0; round < NUM_ROUNDS; round++) {
+		for (size_t i = 0; i < NUM_SERIES; i++) {
+			workspace.intervals.clear();
+			fit_discrepancy(&all_series[i * MAX_YEARS], 2, workspace, workspace.intervals);
+			num_intervals += workspace.intervals.size();
+		}
+	}
+	ce = clock();
+
+	return (double) (ce - cs) / CLOCKS_PER_SEC;
+}
+
+/*
+ * The first series on which the engine and the reference find different
+ * intervals, or different scores for them, or NUM_SERIES when they agree.
+ */
+size_t find_disagreement(const vector<double> &all_series)
+{
+	discrepancy_workspace workspace;
+	interval_vector expected;
+
+	for (size_t i = 0; i < NUM_SERIES; i++) {
+		expected.clear();
+		workspace.intervals.clear();
+		reference_fit_discrepancy(&all_series[i * MAX_YEARS], 2, expected);
+		fit_discrepancy(&all_series[i * MAX_YEARS], 2, workspace, workspace.intervals);
+		sort(expected.begin(), expected.end());
+		sort(workspace.intervals.begin(), workspace.intervals.end());
+		if (expected.size() != workspace.intervals.size())
+			return i;
+		for (size_t j = 0; j < expected.size(); j++)
+			if (expected[j].first != workspace.intervals[j].first ||
+					fabs(expected[j].second - workspace.intervals[j].second) > 1e-12)
+				return i;
+	}
+	return NUM_SERIES;
+}
+
+int main()
+{
+	const double shapes[] = { 3.0, 1.5, 1.1, 0.8 };
+	vector<double> all_series(NUM_SERIES * MAX_YEARS);
+	double series[MAX_YEARS];
+
+	seed_synthetic(2012);
+	for (size_t s = 0; s < sizeof(shapes) / sizeof(*shapes); s++) {
+		for (size_t i = 0; i < NUM_SERIES; i++) {
+			heavy_tailed_series(series, MAX_YEARS, shapes[s]);
+			smoothify_series(series, &all_series[i * MAX_YEARS], MAX_YEARS, 2);
+		}
+
+		size_t disagreement = find_disagreement(all_series);
+		if (disagreement < NUM_SERIES) {
+			fprintf(stderr, "shape=%.1f: the engine disagrees with the reference on series %lu\n",
+				shapes[s], (unsigned long) disagreement);
+			return EXIT_FAILURE;
+		}
+
+		size_t num_reference, num_allocating, num_workspace;
+		double reference = run_reference(all_series, num_reference);
+		double allocating = run_allocating(all_series, num_allocating);
+		double workspace = run_workspace(all_series, num_workspace);
+
+		double num_calls = (double) NUM_SERIES * NUM_ROUNDS;
+		printf("shape=%.1f intervals/word=%.2f reference=%.1f ns/word allocating=%.1f ns/word "
+			"workspace=%.1f ns/word\n", shapes[s], (double) num_workspace / num_calls,
+			1e9 * reference / num_calls, 1e9 * allocating / num_calls,
+			1e9 * workspace / num_calls);
+	}
+
+	return 0;
+}
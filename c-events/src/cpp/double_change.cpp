@@ -0,0 +1,107 @@
+#include "double_change.h"
+#include <cstring>
+#include "dictionary_reader.h"
+
+#define CHANGE_RATIO(count) (1.0 + 0.1 * (count + 1))
+#define DOUBLE_CHANGE_RATIO(count) (1.0 + 0.2 * (count + 1))
+#define INVERSE_CHANGE_RATIO(count) (1.0 - 0.1 * (count + 1))
+#define MIN_SCORED_VALUE 1e-4
+/* Below the smallest change ratio, with a margin for rounding. */
+#define MIN_ADMISSIBLE_RATIO 1.09
+
+static const double sup_ratios[NUM_CHANGE_RATIOS] = {
+	CHANGE_RATIO(0), CHANGE_RATIO(1), CHANGE_RATIO(2),
+	CHANGE_RATIO(3), CHANGE_RATIO(4), CHANGE_RATIO(5),
+	CHANGE_RATIO(6), CHANGE_RATIO(7), CHANGE_RATIO(8),
+};
+
+static const double dsup_ratios[NUM_CHANGE_RATIOS] = {
+	DOUBLE_CHANGE_RATIO(0), DOUBLE_CHANGE_RATIO(1), DOUBLE_CHANGE_RATIO(2),
+	DOUBLE_CHANGE_RATIO(3), DOUBLE_CHANGE_RATIO(4), DOUBLE_CHANGE_RATIO(5),
+	DOUBLE_CHANGE_RATIO(6), DOUBLE_CHANGE_RATIO(7), DOUBLE_CHANGE_RATIO(8),
+};
+
+static const double inf_ratios[NUM_CHANGE_RATIOS] = {
+	INVERSE_CHANGE_RATIO(0), INVERSE_CHANGE_RATIO(1), INVERSE_CHANGE_RATIO(2),
+	INVERSE_CHANGE_RATIO(3), INVERSE_CHANGE_RATIO(4), INVERSE_CHANGE_RATIO(5),
+	INVERSE_CHANGE_RATIO(6), INVERSE_CHANGE_RATIO(7), INVERSE_CHANGE_RATIO(8),
+};
+
+static const double dinf_ratios[NUM_CHANGE_RATIOS] = {
+	1 / DOUBLE_CHANGE_RATIO(0), 1 / DOUBLE_CHANGE_RATIO(1), 1 / DOUBLE_CHANGE_RATIO(2),
+	1 / DOUBLE_CHANGE_RATIO(3), 1 / DOUBLE_CHANGE_RATIO(4), 1 / DOUBLE_CHANGE_RATIO(5),
+	1 / DOUBLE_CHANGE_RATIO(6), 1 / DOUBLE_CHANGE_RATIO(7), 1 / DOUBLE_CHANGE_RATIO(8),
+};
+
+static inline bool change_test(int k, double a, double b, double c)
+{
+	bool up = (b > sup_ratios[k] * a) & (c > sup_ratios[k] * b);
+	bool down = (b < inf_ratios[k] * a) & (c < inf_ratios[k] * b);
+	return up | (b > dsup_ratios[k] * a) | down | (b < dinf_ratios[k] * a);
+}
+
+/*
+ * Every clause of the change test only gets harder as the ratios grow, so the
+ * length of the run of satisfied ratios is simply the number of satisfied
+ * ratios, and only the years which passed a ratio can pass the next one. The
+ * first ratio is tested against all the years at once, in a loop the compiler
+ * vectorizes; the years which passed it are compacted into a list, without
+ * branching on the outcome, and the following ratios only visit that list.
+ */
+void double_change_scores(const double *series, int *counts)
+{
+	double scores[MAX_YEARS];
+	int active[MAX_YEARS];
+	size_t num_active;
+
+	memset(scores, 0, sizeof(scores));
+	for (int j = 2; j < MAX_YEARS - 2; j++) {
+		double a = series[j - 1];
+		double b = series[j];
+		double c = series[j + 1];
+		bool valid = (a >= 0) & (b >= MIN_SCORED_VALUE) & (c >= 0);
+		bool up = (b > sup_ratios[0] * a) & (c > sup_ratios[0] * b);
+		bool down = (b < inf_ratios[0] * a) & (c < inf_ratios[0] * b);
+		bool passed = up | (b > dsup_ratios[0] * a) | down | (b < dinf_ratios[0] * a);
+		scores[j] = (valid & passed) ? 1.0 : 0.0;
+	}
+
+	num_active = 0;
+	for (int j = 2; j < MAX_YEARS - 2; j++) {
+		active[num_active] = j;
+		num_active += (size_t) scores[j];
+	}
+
+	for (int k = 1; k < NUM_CHANGE_RATIOS && num_active > 0; k++) {
+		size_t num_passed = 0;
+		for (size_t i = 0; i < num_active; i++) {
+			int j = active[i];
+			bool passed = change_test(k, series[j - 1], series[j], series[j + 1]);
+			scores[j] += passed ? 1.0 : 0.0;
+			active[num_passed] = j;
+			num_passed += passed;
+		}
+		num_active = num_passed;
+	}
+
+	for (int j = 0; j < MAX_YEARS; j++)
+		counts[j] = (int) scores[j];
+}
+
+/*
+ * A year only scores if it is at least MIN_SCORED_VALUE and differs from the
+ * year before by more than the smallest change ratio, in either direction.
+ * The statistics cover the years from 2 onwards, so the first pair is checked
+ * here.
+ */
+bool double_change_admissible(const double *series, const series_statistics *stats)
+{
+	if (!(stats->max_value >= MIN_SCORED_VALUE))
+		return false;
+	if (stats->max_ratio > MIN_ADMISSIBLE_RATIO)
+		return true;
+
+	double a = series[1];
+	double b = series[2];
+	return !(b <= MIN_ADMISSIBLE_RATIO * a && a <= MIN_ADMISSIBLE_RATIO * b);
+}
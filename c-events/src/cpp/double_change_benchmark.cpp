@@ -0,0 +1,113 @@
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "dictionary_reader.h"
+#include "double_change.h"
+#include "series.h"
+#include "synthetic_series.h"
+
+#define NUM_SERIES 4096
+#define NUM_ROUNDS 16
+
+using namespace std;
+
+/* The original per-year loop, kept as the reference for the kernel. */
+void reference_double_change(const double *series, int *counts)
+{
+	memset(counts, 0, MAX_YEARS * sizeof(*counts));
+	for (int j = 2; j < MAX_YEARS - 2; j++) {
+		double a = series[j - 1];
+		double b = series[j];
+		double c = series[j + 1];
+		if (a >= 0 && b >= 1e-4 && c >= 0) {
+			int count = 0;
+			while (count <= 8) {
+				double sup_ratio = 1.0 + 0.1 * (count + 1);
+				double dsup_ratio = 1.0 + 0.2 * (count + 1);
+				double inf_ratio = 1.0 - 0.1 * (count + 1);
+				double dinf_ratio = 1 / dsup_ratio;
+				if ((b > sup_ratio * a && c > sup_ratio * b) || b > dsup_ratio * a ||
+						(b < inf_ratio * a && c < inf_ratio * b) || b < dinf_ratio * a) {
+					++count;
+				} else {
+					break;
+				}
+			}
+			counts[j] = count;
+		}
+	}
+}
+
+/* Consecutive years in exact ratios, which land on the thresholds themselves. */
+void ratio_series(double *series, size_t size)
+{
+	series[0] = 1e-3;
+	for (size_t i = 1; i < size; i++) {
+		int step = (int) (uniform_sample() * 21) - 10;
+		double ratio = 1.0 + 0.1 * step;
+		if (uniform_sample() < 0.5)
+			ratio = 1.0 + 0.2 * step;
+		if (ratio <= 0.0)
+			ratio = 1 / (1.0 - 0.2 * step);
+		series[i] = series[i - 1] * ratio;
+		if (series[i] > 1.0 || series[i] < 1e-6)
+			series[i] = 1e-3;
+	}
+}
+
+typedef void (*double_change_f)(const double *, int *);
+
+double time_kernel(double_change_f kernel, const vector<double> &all_series,
+	vector<int> &all_counts)
+{
+	clock_t cs, ce;
+
+	cs = clock();
+	for (size_t round = 0; round < NUM_ROUNDS; round++)
+		for (size_t i = 0; i < NUM_SERIES; i++)
+			kernel(&all_series[i * MAX_YEARS], &all_counts[i * MAX_YEARS]);
+	ce = clock();
+
+	return (double) (ce - cs) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+	const char *families[] = { "rare", "smoothed", "ratios" };
+	vector<double> all_series(NUM_SERIES * MAX_YEARS);
+	vector<int> reference_counts(NUM_SERIES * MAX_YEARS);
+	vector<int> kernel_counts(NUM_SERIES * MAX_YEARS);
+	double series[MAX_YEARS];
+
+	seed_synthetic(2012);
+	for (size_t f = 0; f < sizeof(families) / sizeof(*families); f++) {
+		for (size_t i = 0; i < NUM_SERIES; i++) {
+			double *out = &all_series[i * MAX_YEARS];
+			if (f == 0) {
+				heavy_tailed_series(out, MAX_YEARS, 1.1);
+			} else if (f == 1) {
+				heavy_tailed_series(series, MAX_YEARS, 1.5);
+				for (size_t j = 0; j < MAX_YEARS; j++)
+					series[j] *= 1e3;
+				smoothify_series(series, out, MAX_YEARS, 2);
+			} else {
+				ratio_series(out, MAX_YEARS);
+			}
+		}
+
+		double reference = time_kernel(reference_double_change, all_series, reference_counts);
+		double kernel = time_kernel(double_change_scores, all_series, kernel_counts);
+		if (reference_counts != kernel_counts) {
+			fprintf(stderr, "%s: the kernel disagrees with the reference loop\n", families[f]);
+			return EXIT_FAILURE;
+		}
+
+		double num_calls = (double) NUM_SERIES * NUM_ROUNDS;
+		printf("%s: reference=%.1f ns/word kernel=%.1f ns/word\n", families[f],
+			1e9 * reference / num_calls, 1e9 * kernel / num_calls);
+	}
+
+	return 0;
+}
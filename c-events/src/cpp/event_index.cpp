@@ -0,0 +1,223 @@
+#include "event_index.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "dictionary_types.h"
+
+using namespace std;
+
+event_index::event_index(size_t num_years)
+	: num_years(num_years), current_word(NULL), word_added(false)
+{
+	text_offsets.push_back(0);
+}
+
+void event_index::begin_word(const char *word)
+{
+	current_word = word;
+	word_added = false;
+}
+
+void event_index::add(unsigned int year, int score)
+{
+	if (year >= num_years)
+		return;
+
+	if (!word_added) {
+		text.insert(text.end(), current_word, current_word + strlen(current_word) + 1);
+		text_offsets.push_back(text.size());
+		word_added = true;
+	}
+
+	raw_event event = { year, (uint32_t) (text_offsets.size() - 2), score };
+	events.push_back(event);
+}
+
+/*
+ * The events arrive grouped by word, so a stable counting sort by year leaves
+ * the postings of every year ordered by word and the duplicates of a word
+ * next to each other. Scattering those by word then orders each word by year.
+ */
+void event_index::finish()
+{
+	vector<raw_event> by_year(events.size());
+	vector<uint64_t> positions(num_years + 1, 0);
+
+	for (size_t i = 0; i < events.size(); i++)
+		positions[events[i].year + 1]++;
+	for (size_t i = 0; i < num_years; i++)
+		positions[i + 1] += positions[i];
+	for (size_t i = 0; i < events.size(); i++)
+		by_year[positions[events[i].year]++] = events[i];
+
+	year_offsets.assign(num_years + 1, 0);
+	year_postings.clear();
+	for (size_t i = 0; i < by_year.size(); i++) {
+		const raw_event &event = by_year[i];
+		if (i > 0 && by_year[i - 1].year == event.year && by_year[i - 1].word == event.word) {
+			event_posting &last = year_postings.back();
+			last.score = max(last.score, event.score);
+			continue;
+		}
+		event_posting posting = { event.word, event.score };
+		year_postings.push_back(posting);
+		year_offsets[event.year + 1]++;
+	}
+	for (size_t i = 0; i < num_years; i++)
+		year_offsets[i + 1] += year_offsets[i];
+
+	word_offsets.assign(num_words() + 1, 0);
+	word_postings.resize(year_postings.size());
+	for (size_t i = 0; i < year_postings.size(); i++)
+		word_offsets[year_postings[i].id + 1]++;
+	for (size_t i = 0; i < num_words(); i++)
+		word_offsets[i + 1] += word_offsets[i];
+	positions.assign(word_offsets.begin(), word_offsets.end());
+	for (size_t year = 0; year < num_years; year++) {
+		for (uint64_t i = year_offsets[year]; i < year_offsets[year + 1]; i++) {
+			event_posting posting = { (uint32_t) year, year_postings[i].score };
+			word_postings[positions[year_postings[i].id]++] = posting;
+		}
+	}
+
+	vector<raw_event>().swap(events);
+}
+
+size_t event_index::num_words() const
+{
+	return text_offsets.size() - 1;
+}
+
+const char * event_index::word(size_t id) const
+{
+	return &text[text_offsets[id]];
+}
+
+template<class T>
+static bool write_section(FILE *f, const vector<T> &section)
+{
+	static const char zeros[8] = { 0 };
+	const size_t size = section.size() * sizeof(T);
+
+	if (size > 0 && fwrite(&section[0], 1, size, f) != size)
+		return false;
+	return size % 8 == 0 || fwrite(zeros, 1, 8 - size % 8, f) == 8 - size % 8;
+}
+
+static uint64_t aligned_size(size_t size)
+{
+	return (size + 7) / 8 * 8;
+}
+
+int event_index::write(FILE *f) const
+{
+	struct event_index_header header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EVENT_INDEX_MAGIC, sizeof(header.magic));
+	header.version = EVENT_INDEX_VERSION;
+	header.num_years = (uint32_t) num_years;
+	header.num_words = num_words();
+	header.num_postings = year_postings.size();
+	header.year_offsets_offset = aligned_size(sizeof(header));
+	header.year_postings_offset = header.year_offsets_offset +
+		aligned_size(year_offsets.size() * sizeof(uint64_t));
+	header.word_offsets_offset = header.year_postings_offset +
+		aligned_size(year_postings.size() * sizeof(event_posting));
+	header.word_postings_offset = header.word_offsets_offset +
+		aligned_size(word_offsets.size() * sizeof(uint64_t));
+	header.text_offsets_offset = header.word_postings_offset +
+		aligned_size(word_postings.size() * sizeof(event_posting));
+	header.text_offset = header.text_offsets_offset +
+		aligned_size(text_offsets.size() * sizeof(uint64_t));
+
+	if (fwrite(&header, sizeof(header), 1, f) != 1)
+		return -1;
+	if (!write_section(f, year_offsets) || !write_section(f, year_postings) ||
+			!write_section(f, word_offsets) || !write_section(f, word_postings) ||
+			!write_section(f, text_offsets) || !write_section(f, text))
+		return -1;
+	return 0;
+}
+
+/* The words zeitgeist.py kept in its documents */
+bool event_index::is_document_word(size_t id) const
+{
+	const char *first = word(id);
+	const char *last = first + (text_offsets[id + 1] - text_offsets[id] - 1);
+
+	if (first == last || !isalpha((unsigned char) *first))
+		return false;
+	for (const char *p = first; p != last; p++)
+		if (*p == '.' || *p == ',' || *p == '_')
+			return false;
+	return true;
+}
+
+/* One row per year, with every word repeated as many times as its score. */
+int event_index::export_history(FILE *f) const
+{
+	unsigned int row_id = 0;
+
+	for (size_t year = HISTORY_MIN_YEAR; year < num_years; year++) {
+		bool empty = true;
+		for (uint64_t i = year_offsets[year]; i < year_offsets[year + 1]; i++) {
+			const event_posting &posting = year_postings[i];
+			if (!is_document_word(posting.id))
+				continue;
+			for (int32_t j = 0; j < posting.score; j++) {
+				if (empty) {
+					fprintf(f, "%u,%u,year %u,", ++row_id, (unsigned int) year,
+						(unsigned int) (MIN_YEAR + year));
+					empty = false;
+				} else {
+					fputc(' ', f);
+				}
+				fputs(word(posting.id), f);
+			}
+		}
+		if (!empty)
+			fputc('\n', f);
+	}
+
+	return ferror(f) ? -1 : 0;
+}
+
+/*
+ * One row per word, in the order of their first year, with every year
+ * repeated as many times as its score.
+ */
+int event_index::export_revhist(FILE *f) const
+{
+	vector<bool> seen(num_words(), false);
+	vector<uint32_t> order;
+	unsigned int row_id = 0;
+
+	for (size_t year = HISTORY_MIN_YEAR; year < num_years; year++) {
+		for (uint64_t i = year_offsets[year]; i < year_offsets[year + 1]; i++) {
+			const uint32_t id = year_postings[i].id;
+			if (!seen[id] && is_document_word(id)) {
+				seen[id] = true;
+				order.push_back(id);
+			}
+		}
+	}
+
+	for (size_t k = 0; k < order.size(); k++) {
+		const uint32_t id = order[k];
+		const char *separator = "";
+		fprintf(f, "%u,%s,word %s,", ++row_id, word(id), word(id));
+		for (uint64_t i = word_offsets[id]; i < word_offsets[id + 1]; i++) {
+			const event_posting &posting = word_postings[i];
+			if (posting.id < HISTORY_MIN_YEAR)
+				continue;
+			for (int32_t j = 0; j < posting.score; j++) {
+				fprintf(f, "%s%u", separator, (unsigned int) (MIN_YEAR + posting.id));
+				separator = " ";
+			}
+		}
+		fputc('\n', f);
+	}
+
+	return ferror(f) ? -1 : 0;
+}
@@ -1,11 +1,11 @@
 #include "gaussian_finder.h"
 #include <algorithm>
-#include <bitset>
 #include <limits>
 #include <cmath>
 #include <gsl/gsl_randist.h>
 #include "dictionary_reader.h"
 #include "gaussian_model.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -32,8 +32,9 @@ void select_gaussians(const double *series, size_t inf, size_t sup, vector<gauss
 				min_sum = sum - (right - left + 1) * min_value;
 				kurtosis = compute_kurtosis(partial_moments, left, right,
 					min_value, min_sum, &mean, &sigma);
-				if ((left >= 494 && left <= 496) && (right >= 504))
-					printf("(%zu,%zu) DAT KURTOSIS %lf vs emd=%lf\n", left, right, kurtosis, compute_emd(series, left, right, min_value, min_sum, mean, sigma));
+				TRACE(TRACE_GAUSSIANS, TRACE_LEVEL_CANDIDATES, TRACE_GAUSSIAN_CANDIDATE,
+					(double) left, (double) right, kurtosis,
+					compute_emd(series, left, right, min_value, min_sum, mean, sigma));
 				if (fabs(kurtosis) < .05) {
 					emd = compute_emd(series, left, right, min_value, min_sum, mean, sigma);
 					if (emd < .3) {
@@ -43,51 +44,119 @@ void select_gaussians(const double *series, size_t inf, size_t sup, vector<gauss
 						size_t true_right = min(right, safe_right);
 						double max_probability = gsl_ran_gaussian_pdf(0, sigma);
 						double increase = min_sum * max_probability / min_value;
-						printf("{} %zu %zu :: (%lf, %lf) :: [%lf, %lf] :: <%lf, %lf> :: %lf\n", true_left, true_right,
-							mean, sigma, emd, kurtosis, min_value, min_sum * max_probability, increase);
+						TRACE(TRACE_GAUSSIANS, TRACE_LEVEL_EVENTS, TRACE_GAUSSIAN_ACCEPTED,
+							(double) true_left, (double) true_right, mean, sigma, emd, kurtosis,
+							min_value, min_sum * max_probability, increase);
 						gaussians.push_back(gaussian_entry(true_left, true_right, mean, sigma, emd, increase));
 					}
 				}
 			}
 		}
 	}
-	sort(gaussians.begin(), gaussians.end());
+	make_heap(gaussians.begin(), gaussians.end(), gaussian_entry_after());
 }
 
-void relevant_gaussians(const vector<gaussian_entry> &gaussians,
-	vector< pair<size_t, int> > &relevant_counts, double widening)
+interval_index::interval_index() : intervals(), num_covered(0) { }
+
+void interval_index::clear()
 {
-	bitset<MAX_YEARS> used;
+	intervals.clear();
+	num_covered = 0;
+}
+
+bool interval_index::overlaps(size_t left, size_t right) const
+{
+	map<size_t, size_t>::const_iterator it = intervals.upper_bound(right);
+	if (it == intervals.begin())
+		return false;
+	--it;
+	return it->second >= left;
+}
+
+void interval_index::insert(size_t left, size_t right)
+{
+	intervals[left] = right;
+	num_covered += right - left + 1;
+}
+
+size_t interval_index::covered() const
+{
+	return num_covered;
+}
+
+/*
+ * The candidates are only ordered as far as they are popped: the selection
+ * stops as soon as the picked intervals cover every year a candidate could
+ * still claim.
+ */
+void pick_gaussians(vector<gaussian_entry> &gaussians, vector<gaussian_entry> &picked)
+{
+	interval_index used;
+	size_t inf = numeric_limits<size_t>::max();
+	size_t sup = 0;
 
-	relevant_counts.clear();
 	for (vector<gaussian_entry>::const_iterator it = gaussians.begin(); it != gaussians.end(); ++it) {
-		size_t left = it->left;
-		size_t right = it->right;
-		bool valid = true;
-		for (size_t i = left; i <= right; i++)
-			if (used[i]) {
-				valid = false;
-				break;
-			}
-		if (valid) {
-			double max_probability = gsl_ran_gaussian_pdf(0, it->sigma);
-			double increase = min(it->increase, 1.0);
-			int count = (int) (10 * increase);
-			double ratio = (count + .5) / max_probability;
-			double mean = it->mean;
-			double sigma = it->sigma;
-			for (size_t i = left; i <= right; i++) {
-				used[i] = true;
-				int entry_count;
-				if (widening != numeric_limits<double>::max()) {
-					double sample = gsl_ran_gaussian_pdf(i - mean, widening * sigma);
-					entry_count = (int) (ratio * sample);
-				} else {
-					entry_count = count;
-				}
-				if (entry_count > 0)
-					relevant_counts.push_back(make_pair(i, entry_count));
+		inf = min(inf, it->left);
+		sup = max(sup, it->right);
+	}
+
+	picked.clear();
+	while (!gaussians.empty() && used.covered() < sup - inf + 1) {
+		pop_heap(gaussians.begin(), gaussians.end(), gaussian_entry_after());
+		const gaussian_entry &candidate = gaussians.back();
+		if (!used.overlaps(candidate.left, candidate.right)) {
+			used.insert(candidate.left, candidate.right);
+			picked.push_back(candidate);
+		}
+		gaussians.pop_back();
+	}
+}
+
+void widen_gaussians(const vector<gaussian_entry> &picked,
+	vector< pair<size_t, int> > &relevant_counts, double widening)
+{
+	relevant_counts.clear();
+	for (vector<gaussian_entry>::const_iterator it = picked.begin(); it != picked.end(); ++it) {
+		double max_probability = gsl_ran_gaussian_pdf(0, it->sigma);
+		double increase = min(it->increase, 1.0);
+		int count = (int) (10 * increase);
+		double ratio = (count + .5) / max_probability;
+		double mean = it->mean;
+		double sigma = it->sigma;
+		for (size_t i = it->left; i <= it->right; i++) {
+			int entry_count;
+			if (widening != numeric_limits<double>::max()) {
+				double sample = gsl_ran_gaussian_pdf(i - mean, widening * sigma);
+				entry_count = (int) (ratio * sample);
+			} else {
+				entry_count = count;
 			}
+			if (entry_count > 0)
+				relevant_counts.push_back(make_pair(i, entry_count));
 		}
 	}
 }
+
+void relevant_gaussians(const vector<gaussian_entry> &gaussians,
+	vector< pair<size_t, int> > &relevant_counts, double widening)
+{
+	vector<gaussian_entry> candidates(gaussians);
+	vector<gaussian_entry> picked;
+
+	pick_gaussians(candidates, picked);
+	widen_gaussians(picked, relevant_counts, widening);
+}
+
+/*
+ * A flat series leaves no excess over the minimum of any window, so no
+ * candidate reaches a positive count. Everything else is admissible unless a
+ * recall-trading threshold is set.
+ */
+bool gaussians_admissible(const series_statistics &stats, double min_burstiness)
+{
+	if (!(stats.max_value > stats.min_value))
+		return false;
+	if (min_burstiness > 0.0 && !(stats.burstiness >= min_burstiness))
+		return false;
+	return true;
+}
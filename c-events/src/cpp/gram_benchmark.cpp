@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "dictionary_reader.h"
+#include "sparse_relevance.h"
+#include "synthetic_series.h"
+
+#define NUM_WORDS 20000
+#define BLOCK_SIZE 2048
+
+using namespace std;
+
+typedef void (*gram_method)(const sparse_relevance &matrix, vector<float> &gram);
+
+static void build_matrix(size_t num_events, sparse_relevance &matrix)
+{
+	int counts[MAX_YEARS];
+
+	matrix.num_rows = NUM_WORDS;
+	matrix.num_cols = MAX_YEARS;
+	matrix.indptr.assign(1, 0);
+	matrix.indices.clear();
+	matrix.values.clear();
+	for (size_t i = 0; i < NUM_WORDS; i++) {
+		bursty_relevance_row(counts, MAX_YEARS, num_events);
+		for (size_t j = 0; j < MAX_YEARS; j++) {
+			if (counts[j] != 0) {
+				matrix.indices.push_back((uint32_t) j);
+				matrix.values.push_back((float) counts[j]);
+			}
+		}
+		matrix.indptr.push_back(matrix.indices.size());
+	}
+}
+
+/* The loop clustering used to run, over dense year rows */
+static void dense_nested_loop(const sparse_relevance &matrix, vector<float> &gram)
+{
+	const size_t n = matrix.num_cols;
+	vector<float> lengths;
+	vector<float> relevance(n * matrix.num_rows, 0.0f);
+
+	year_lengths(matrix, lengths);
+	for (size_t row = 0; row < matrix.num_rows; row++) {
+		for (uint64_t k = matrix.indptr[row]; k < matrix.indptr[row + 1]; k++) {
+			const uint32_t year = matrix.indices[k];
+			relevance[year * matrix.num_rows + row] = matrix.values[k] / lengths[year];
+		}
+	}
+
+	gram.assign(n * n, 0.0f);
+	for (size_t x = 0; x < n; x++) {
+		if (!(lengths[x] > 0.0f))
+			continue;
+		for (size_t y = x; y < n; y++) {
+			if (!(lengths[y] > 0.0f))
+				continue;
+			float sum = 0.0f;
+			for (size_t j = 0; j < matrix.num_rows; j++)
+				sum += relevance[x * matrix.num_rows + j] * relevance[y * matrix.num_rows + j];
+			gram[x * n + y] = sum;
+		}
+	}
+}
+
+static void sparse_pairs(const sparse_relevance &matrix, vector<float> &gram)
+{
+	const size_t n = matrix.num_cols;
+	vector<sparse_vector> years;
+
+	relevance_to_year_vectors(matrix, years);
+	gram.assign(n * n, 0.0f);
+	for (size_t x = 0; x < n; x++)
+		for (size_t y = x; y < n; y++)
+			gram[x * n + y] = sparse_dot(years[x], years[y]);
+}
+
+static void blocked_blas(const sparse_relevance &matrix, vector<float> &gram)
+{
+	year_gram_matrix_blocked(matrix, gram, BLOCK_SIZE);
+}
+
+static double run(gram_method method, const sparse_relevance &matrix, vector<float> &gram)
+{
+	clock_t cs, ce;
+
+	cs = clock();
+	method(matrix, gram);
+	ce = clock();
+
+	return (double) (ce - cs) / CLOCKS_PER_SEC;
+}
+
+static float max_difference(const vector<float> &x, const vector<float> &y, size_t n)
+{
+	float difference = 0.0f;
+
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = i; j < n; j++)
+			difference = max(difference, fabsf(x[i * n + j] - y[i * n + j]));
+	return difference;
+}
+
+int main()
+{
+	const size_t num_events[] = { 2, 8, 32 };
+	const char *names[] = { "sparse pairs", "accumulated", "blocked ssyrk" };
+	const gram_method methods[] = { sparse_pairs, year_gram_matrix, blocked_blas };
+	sparse_relevance matrix;
+	vector<float> reference, gram;
+
+	seed_synthetic(1914);
+	for (size_t s = 0; s < sizeof(num_events) / sizeof(*num_events); s++) {
+		build_matrix(num_events[s], matrix);
+		double dense = run(dense_nested_loop, matrix, reference);
+		printf("events/word=%lu nonzeros=%lu dense loop=%.3fs\n",
+			(unsigned long) num_events[s], (unsigned long) matrix.indices.size(), dense);
+
+		for (size_t m = 0; m < sizeof(methods) / sizeof(*methods); m++) {
+			double elapsed = run(methods[m], matrix, gram);
+			float difference = max_difference(reference, gram, MAX_YEARS);
+			printf("  %-14s %.3fs (%.1fx) max difference=%g\n", names[m], elapsed,
+				dense / elapsed, difference);
+			if (difference > 1e-4f) {
+				fprintf(stderr, "%s disagrees with the dense loop\n", names[m]);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,497 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dictionary_reader.h"
+#include "mapped_file.h"
+#include "synthetic_series.h"
+#include "util.h"
+#include "word_selection.h"
+
+#define BASE_FILENAME "data/sort/googlebooks-eng-all-1gram-20120701-database"
+#define DEFAULT_NUM_TABLES 100000
+#define DIRECT_ALIGNMENT 4096
+#define PRECACHE_BUFFER_SIZE (1 << 20)
+
+using namespace std;
+
+enum read_method { STDIO_METHOD, MMAP_METHOD, PREAD_METHOD, DIRECT_METHOD, NUM_METHODS };
+enum cache_state { COLD_CACHE, WARM_CACHE, PRECACHED, NUM_CACHE_STATES };
+
+static const char *method_names[] = { "stdio", "mmap", "pread", "direct" };
+static const char *cache_names[] = { "cold", "warm", "precache" };
+
+/* A sequence of tables to read, in the order they are read */
+struct access_trace {
+	string name;
+	vector<size_t> indices;
+};
+
+/*
+ * What every method reads through: the reader's FILE for read_table, the
+ * mapped time file, or a descriptor of its own, opened with O_DIRECT for
+ * the direct method.
+ */
+struct table_source {
+	const struct dictionary_reader *dict;
+	enum read_method method;
+	struct mapped_file mapped;
+	int fd;
+	void *aligned;
+	size_t aligned_size;
+};
+
+struct trace_result {
+	size_t num_tables;
+	unsigned long long num_bytes;
+	unsigned long long checksum;
+	double seconds;
+	double precache_seconds;
+	vector<double> latencies;
+};
+
+static double now_seconds()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+static string time_filename()
+{
+	return string(BASE_FILENAME) + ".time";
+}
+
+/*
+ * Drops the pages of the time file from the page cache; it is only read,
+ * so the kernel can always let them go, and unlike drop_caches this needs
+ * no privileges and leaves the rest of the system alone.
+ */
+static int evict_time_file()
+{
+	int fd = open(time_filename().c_str(), O_RDONLY);
+	int err;
+
+	if (fd < 0)
+		return 1;
+	err = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+	return err != 0;
+}
+
+/* Reads the whole time file through, as precache does */
+static int precache_time_file(double *seconds)
+{
+	vector<unsigned char> buffer(PRECACHE_BUFFER_SIZE);
+	const double start = now_seconds();
+	FILE *f = fopen(time_filename().c_str(), "rb");
+
+	if (f == NULL)
+		return 1;
+	while (fread(&buffer[0], 1, buffer.size(), f) == buffer.size())
+		;
+	fclose(f);
+	*seconds = now_seconds() - start;
+	return 0;
+}
+
+static int open_source(struct table_source *self, const struct dictionary_reader *dict,
+	enum read_method method)
+{
+	self->dict = dict;
+	self->method = method;
+	self->mapped.data = NULL;
+	self->mapped.size = 0;
+	self->fd = -1;
+	self->aligned = NULL;
+	self->aligned_size = 0;
+
+	switch (method) {
+	case STDIO_METHOD:
+		return 0;
+	case MMAP_METHOD:
+		return map_file(&self->mapped, time_filename().c_str());
+	case PREAD_METHOD:
+		self->fd = open(time_filename().c_str(), O_RDONLY);
+		return self->fd < 0;
+	case DIRECT_METHOD:
+		self->fd = open(time_filename().c_str(), O_RDONLY | O_DIRECT);
+		return self->fd < 0;
+	default:
+		return 1;
+	}
+}
+
+static void close_source(struct table_source *self)
+{
+	unmap_file(&self->mapped);
+	if (self->fd >= 0)
+		close(self->fd);
+	free(self->aligned);
+	self->fd = -1;
+	self->aligned = NULL;
+}
+
+/*
+ * O_DIRECT reads whole aligned blocks into an aligned buffer, so the table
+ * is copied out of the blocks which cover it.
+ */
+static int read_direct(struct table_source *self, off_t offset, size_t size,
+	struct time_entry *table)
+{
+	const off_t first = offset - offset % DIRECT_ALIGNMENT;
+	const size_t span = (size_t) (offset - first) + size;
+	const size_t aligned_size = (span + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+	ssize_t num_read;
+
+	if (aligned_size > self->aligned_size) {
+		free(self->aligned);
+		self->aligned = NULL;
+		self->aligned_size = 0;
+		if (posix_memalign(&self->aligned, DIRECT_ALIGNMENT, aligned_size) != 0)
+			return 1;
+		self->aligned_size = aligned_size;
+	}
+	num_read = pread(self->fd, self->aligned, aligned_size, first);
+	if (num_read < 0 || (size_t) num_read < span)
+		return 1;
+	memcpy(table, (const char *) self->aligned + (offset - first), size);
+	return 0;
+}
+
+static int read_source_table(struct table_source *self, size_t index, struct time_entry *table,
+	size_t *table_size)
+{
+	const struct db_entry *entry = &self->dict->database[index];
+	const off_t offset = (off_t) entry->time_offset;
+	const size_t size = entry->time_length * sizeof(*table);
+
+	*table_size = entry->time_length;
+	switch (self->method) {
+	case STDIO_METHOD:
+		return read_table(self->dict, index, table, table_size);
+	case MMAP_METHOD:
+		if ((size_t) offset + size > self->mapped.size)
+			return 1;
+		memcpy(table, (const char *) self->mapped.data + offset, size);
+		return 0;
+	case PREAD_METHOD:
+		return pread(self->fd, table, size, offset) != (ssize_t) size;
+	case DIRECT_METHOD:
+		return read_direct(self, offset, size, table);
+	default:
+		return 1;
+	}
+}
+
+static int replay_trace(struct table_source *source, const access_trace &trace,
+	vector<time_entry> &table, trace_result *result)
+{
+	size_t table_size;
+	double start, end;
+
+	result->num_tables = 0;
+	result->num_bytes = 0;
+	result->checksum = 0;
+	result->latencies.clear();
+	result->latencies.reserve(trace.indices.size());
+	for (size_t i = 0; i < trace.indices.size(); i++) {
+		start = now_seconds();
+		if (read_source_table(source, trace.indices[i], &table[0], &table_size) != 0) {
+			fprintf(stderr, "Could not read the table of: %s\n",
+				source->dict->words[trace.indices[i]]);
+			return 1;
+		}
+		end = now_seconds();
+		result->latencies.push_back(end - start);
+		result->num_tables++;
+		result->num_bytes += table_size * sizeof(table[0]);
+		for (size_t j = 0; j < table_size; j++)
+			result->checksum += table[j].match_count;
+	}
+	return 0;
+}
+
+/*
+ * Reads the trace with the method from the page cache in the given state:
+ * cold right after its eviction, warm after a first untimed replay, and
+ * precached after reading the whole time file through from cold.
+ */
+static int run_trace(const struct dictionary_reader *dict, const access_trace &trace,
+	enum read_method method, enum cache_state state, vector<time_entry> &table,
+	trace_result *result)
+{
+	struct table_source source;
+	int err;
+
+	result->precache_seconds = 0.0;
+	if (state != WARM_CACHE && evict_time_file() != 0)
+		fprintf(stderr, "Could not evict the time file, the reads may not be cold\n");
+	if (state == PRECACHED && precache_time_file(&result->precache_seconds) != 0)
+		return 1;
+
+	err = open_source(&source, dict, method);
+	if (err != 0) {
+		fprintf(stderr, "Could not open the time file for %s reads: %s\n",
+			method_names[method], strerror(errno));
+		return err;
+	}
+	if (state == WARM_CACHE) {
+		err = replay_trace(&source, trace, table, result);
+		if (err != 0)
+			goto out_source;
+	}
+
+	{
+		const double start = now_seconds();
+		err = replay_trace(&source, trace, table, result);
+		result->seconds = now_seconds() - start;
+	}
+
+out_source:
+	close_source(&source);
+	return err;
+}
+
+static double percentile(const vector<double> &sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0.0;
+	return sorted[min((size_t) (fraction * (double) sorted.size()), sorted.size() - 1)];
+}
+
+static void report(const access_trace &trace, enum read_method method, enum cache_state state,
+	trace_result &result, FILE *csv)
+{
+	const double megabytes = (double) result.num_bytes / (1 << 20);
+
+	sort(result.latencies.begin(), result.latencies.end());
+	const double p50 = 1e6 * percentile(result.latencies, 0.5);
+	const double p90 = 1e6 * percentile(result.latencies, 0.9);
+	const double p99 = 1e6 * percentile(result.latencies, 0.99);
+	const double max_latency = 1e6 * percentile(result.latencies, 1.0);
+
+	printf("%-10s %-6s %-8s %9.1f MB/s %11.0f tables/s %8.1f %8.1f %8.1f %9.1f us\n",
+		trace.name.c_str(), method_names[method], cache_names[state],
+		megabytes / result.seconds, (double) result.num_tables / result.seconds,
+		p50, p90, p99, max_latency);
+	if (result.precache_seconds > 0.0)
+		printf("%-10s %-6s %-8s precaching the time file took %.2f s\n", trace.name.c_str(),
+			method_names[method], cache_names[state], result.precache_seconds);
+	if (csv != NULL)
+		fprintf(csv, "%s,%s,%s,%lu,%llu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.3f\n",
+			trace.name.c_str(), method_names[method], cache_names[state],
+			(unsigned long) result.num_tables, result.num_bytes, megabytes / result.seconds,
+			(double) result.num_tables / result.seconds, p50, p90, p99, max_latency,
+			result.precache_seconds);
+}
+
+/* The words of the file, in its order, as a trace which repeats itself as written */
+static int load_trace(const struct dictionary_reader *dict, const char *filename,
+	access_trace &trace)
+{
+	char *line = NULL;
+	size_t capacity = 0, length, num_unknown = 0;
+	ssize_t num_read;
+	long index;
+	FILE *f;
+
+	f = fopen(filename, "rt");
+	if (f == NULL) {
+		fprintf(stderr, "Could not open for reading: %s\n", filename);
+		return 1;
+	}
+	trace.name = "trace";
+	while ((num_read = getline(&line, &capacity, f)) > 0) {
+		length = (size_t) num_read;
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			length--;
+		line[length] = 0;
+		if (length == 0)
+			continue;
+		index = find_word(dict, line);
+		if (index < 0 || dict->database[index].time_length == 0)
+			num_unknown++;
+		else
+			trace.indices.push_back((size_t) index);
+	}
+	if (num_unknown > 0)
+		printf("%lu words of the trace have no table\n", (unsigned long) num_unknown);
+	free(line);
+	fclose(f);
+	return 0;
+}
+
+/*
+ * The same sample of the selected words twice: in the order of the time
+ * file, which sorter lays out in word order, and shuffled.
+ */
+static int sample_traces(const struct dictionary_reader *dict,
+	const struct word_selection &selection, size_t num_tables, unsigned int seed,
+	vector<access_trace> &traces)
+{
+	size_t *selected, num_selected;
+	vector<size_t> sample;
+	access_trace sequential, random;
+
+	if (select_words(dict, &selection, &selected, &num_selected) != 0)
+		return 1;
+	for (size_t i = 0; i < num_selected; i++)
+		if (dict->database[selected[i]].time_length > 0)
+			sample.push_back(selected[i]);
+	free(selected);
+
+	seed_synthetic(seed);
+	for (size_t i = sample.size(); i > 1; i--)
+		swap(sample[i - 1], sample[(size_t) (uniform_sample() * (double) i) % i]);
+	sample.resize(min(sample.size(), num_tables));
+
+	random.name = "random";
+	random.indices = sample;
+	sequential.name = "sequential";
+	sequential.indices = sample;
+	sort(sequential.indices.begin(), sequential.indices.end());
+	traces.push_back(sequential);
+	traces.push_back(random);
+	return 0;
+}
+
+static int parse_name(const char *value, const char **names, int num_names)
+{
+	for (int i = 0; i < num_names; i++)
+		if (strcmp(value, names[i]) == 0)
+			return i;
+	fprintf(stderr, "Unknown name: %s\n", value);
+	return -1;
+}
+
+/*
+ * Usage: io_benchmark [--tables N] [--seed N] [--trace FILE] [--method NAME]
+ *	[--cache NAME] [--csv FILE] [--words FILE] [--regex PATTERN]
+ *	[--prefix PREFIX] [--min-count N] [--max-count N]
+ * Replays reads of the tables of the sorted dictionary and reports MB/s,
+ * tables/s and the 50th, 90th and 99th percentiles and maximum of the
+ * latency of a table. By default N tables (100000) sampled from the
+ * selected words are read in sequential and in random order; --trace
+ * replays the words of a file in its order instead. Every trace is read
+ * with read_table (stdio), from the mapped time file (mmap), with pread
+ * and with O_DIRECT reads (direct), from a cold, a warm and a precached
+ * page cache, unless --method stdio|mmap|pread|direct or --cache
+ * cold|warm|precache restrict them. --csv also writes the results as
+ * comma-separated values.
+ */
+int main(int argc, char **argv)
+{
+	vector<char *> selection_args(1, argv[0]);
+	vector<access_trace> traces;
+	vector<time_entry> table;
+	struct word_selection selection;
+	struct dictionary_reader dict;
+	size_t num_tables = DEFAULT_NUM_TABLES;
+	unsigned int seed = 2012;
+	const char *trace_filename = NULL;
+	const char *csv_filename = NULL;
+	FILE *csv = NULL;
+	int only_method = -1, only_cache = -1;
+	int err;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--tables") == 0 && i + 1 < argc)
+			num_tables = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (unsigned int) strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			trace_filename = argv[++i];
+		else if (strcmp(argv[i], "--method") == 0 && i + 1 < argc) {
+			only_method = parse_name(argv[++i], method_names, NUM_METHODS);
+			if (only_method < 0)
+				return EXIT_FAILURE;
+		} else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+			only_cache = parse_name(argv[++i], cache_names, NUM_CACHE_STATES);
+			if (only_cache < 0)
+				return EXIT_FAILURE;
+		} else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			csv_filename = argv[++i];
+		else
+			selection_args.push_back(argv[i]);
+	}
+	init_word_selection(&selection);
+	if (parse_word_selection(&selection, (int) selection_args.size(), &selection_args[0]) != 0)
+		return EXIT_FAILURE;
+
+	err = init_dictreader(&dict, BASE_FILENAME);
+	if (err != 0) {
+		fprintf(stderr, "Could not open the sorted dictionary: %s\n", BASE_FILENAME);
+		return EXIT_FAILURE;
+	}
+
+	if (trace_filename != NULL) {
+		traces.push_back(access_trace());
+		err = load_trace(&dict, trace_filename, traces.back());
+	} else {
+		err = sample_traces(&dict, selection, num_tables, seed, traces);
+	}
+	if (err != 0)
+		goto out_reader;
+
+	{
+		size_t max_table_size = 1;
+		for (size_t t = 0; t < traces.size(); t++)
+			for (size_t i = 0; i < traces[t].indices.size(); i++)
+				max_table_size = max(max_table_size,
+					(size_t) dict.database[traces[t].indices[i]].time_length);
+		table.resize(max_table_size);
+	}
+
+	if (csv_filename != NULL) {
+		csv = fopen(csv_filename, "wt");
+		if (csv == NULL) {
+			fprintf(stderr, "Could not open for writing: %s\n", csv_filename);
+			err = 1;
+			goto out_reader;
+		}
+		fprintf(csv, "trace,method,cache,tables,bytes,mb_per_s,tables_per_s,p50_us,p90_us,"
+			"p99_us,max_us,precache_s\n");
+	}
+
+	printf("%-10s %-6s %-8s %14s %19s %8s %8s %8s %12s\n", "trace", "method", "cache",
+		"throughput", "", "p50", "p90", "p99", "max");
+	for (size_t t = 0; t < traces.size(); t++) {
+		unsigned long long checksum = 0;
+		bool has_checksum = false;
+		for (int m = 0; m < NUM_METHODS; m++) {
+			if (only_method >= 0 && m != only_method)
+				continue;
+			for (int c = 0; c < NUM_CACHE_STATES; c++) {
+				trace_result result;
+				if (only_cache >= 0 && c != only_cache)
+					continue;
+				if (run_trace(&dict, traces[t], (enum read_method) m, (enum cache_state) c,
+						table, &result) != 0)
+					continue;
+				/* Every method must read the same counts */
+				if (has_checksum && result.checksum != checksum)
+					fprintf(stderr, "The %s reads of the %s trace differ from the others\n",
+						method_names[m], traces[t].name.c_str());
+				checksum = result.checksum;
+				has_checksum = true;
+				report(traces[t], (enum read_method) m, (enum cache_state) c, result, csv);
+			}
+		}
+	}
+
+	if (csv != NULL && fclose(csv) != 0) {
+		fprintf(stderr, "Could not write: %s\n", csv_filename);
+		err = 1;
+	}
+out_reader:
+	destroy_dictreader(&dict);
+	return err != 0 ? EXIT_FAILURE : 0;
+}
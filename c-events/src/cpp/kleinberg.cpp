@@ -105,10 +105,19 @@ bool batch_viterbi(const vector<unsigned int> &docs, const vector<unsigned int>
 }
 
 kleinberg_processor::kleinberg_processor(vector<unsigned int> &docs,
-	vector<unsigned int> &relevant, const char *filename)
-	: docs(docs), relevant(relevant), efile(filename) { }
+	vector<unsigned int> &relevant, const char *filename, relevance_format format)
+	: docs(docs), relevant(relevant), efile(filename)
+{
+	if (init_relevance_matrix(&matrix, efile.f, format, MAX_YEARS) != 0)
+		throw file_exception();
+	if (sink.open(efile.f) != 0)
+		throw file_exception();
+}
 
-kleinberg_processor::~kleinberg_processor() { }
+kleinberg_processor::~kleinberg_processor()
+{
+	finish_relevance_matrix(&matrix);
+}
 
 void kleinberg_processor::compute_relevance(const char *word)
 {
@@ -122,7 +131,10 @@ void kleinberg_processor::compute_relevance(const char *word)
 		counts[i] = hidden_states[i];
 	fill(counts + num_elems, counts + MAX_YEARS, 0);
 
-	print_relevance_csv(efile.f, word, counts, MAX_YEARS);
+	if (matrix.format == RELEVANCE_CSV)
+		print_relevance_csv(efile.f, word, counts, MAX_YEARS);
+	else
+		append_relevance_row(&matrix, counts);
 }
 
 void kleinberg_processor::compute_summary(const char *word)
@@ -132,18 +144,24 @@ void kleinberg_processor::compute_summary(const char *word)
 	batch_viterbi(docs, relevant, hidden_states);
 
 	const size_t num_elems = min<size_t>(hidden_states.size(), MAX_YEARS);
+	sink.begin_word(word);
 	for (size_t i = 0; i < num_elems; i++) {
 		int score = hidden_states[i];
 		if (score > 0)
-			print_summary_txt(efile.f, word, (unsigned int) i, score);
+			sink.append((unsigned int) i, score);
 	}
 }
 
+void kleinberg_processor::attach_index(event_index *index)
+{
+	sink.attach_index(index);
+}
+
 kleinberg_processor * kleinberg_processor::create(vector<unsigned int> &docs,
-	vector<unsigned int> &relevant, const char *filename)
+	vector<unsigned int> &relevant, const char *filename, relevance_format format)
 {
 	try {
-		return new kleinberg_processor(docs, relevant, filename);
+		return new kleinberg_processor(docs, relevant, filename, format);
 	} catch (file_exception &fe) {
 		return NULL;
 	}
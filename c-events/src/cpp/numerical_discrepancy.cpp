@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <cstring>
 #include "dictionary_reader.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -13,140 +14,181 @@ pair<size_t, size_t> add_to_pair(pair<size_t, size_t> p, size_t offset)
 	return make_pair(p.first + offset, p.second + offset);
 }
 
-void append_indices(const vector< pair<size_t, size_t> > &indices,
-	vector< pair< pair<size_t, size_t>, double > > &intervals,
-	size_t offset, const vector<double> &sums, size_t s_off)
-{
-	for (size_t i = 0; i < indices.size(); i++) {
-		pair<size_t, size_t> interval = add_to_pair(indices[i], offset);
-		double score = sums[interval.second + 1 - s_off] -
-			sums[interval.first - s_off];
-		intervals.push_back(make_pair(interval, score));
-	}
-}
-
+/*
+ * All maximal scoring subsequences in the sense of Ruzzo and Tompa, in linear
+ * time. The candidate list is kept as a stack whose left cumulative sums are
+ * strictly increasing: a segment popped while searching for its successor's
+ * predecessor can never be the predecessor of a later segment, so every
+ * segment is pushed and popped at most once. The popped segments that survive
+ * are remembered through segment_end, indexed by their starting position, and
+ * recovered by a final left-to-right scan which skips over merged segments.
+ */
 template<class T>
 void compute_max_sequences(const T *v, size_t n, vector<T> &sums,
+	vector<max_segment> &stack, vector<size_t> &segment_end,
 	vector< pair<size_t, size_t> > &indices)
 {
-	vector<size_t> back_ptr;
-
-	sums.push_back((T) 0);
+	sums.resize(n + 1);
+	sums[0] = (T) 0;
 	for (size_t i = 0; i < n; i++)
-		sums.push_back(sums.back() + v[i]);
+		sums[i + 1] = sums[i] + v[i];
 
-	size_t inf_index = 0;
+	stack.clear();
+	segment_end.assign(n, n);
 	for (size_t i = 0; i < n; i++) {
 		if (v[i] > 0) {
 			size_t si = i;
 			while (si + 1 < n && v[si + 1] > 0)
 				++si;
-			indices.push_back(make_pair(i, si));
-			back_ptr.push_back(n);
+			max_segment current(i, si);
 			i = si;
 			while (true) {
-				T left = sums[indices.back().first];
-				size_t j = back_ptr.back();
-				bool found = (j < n);
-				if (!found) {
-					if (indices.size() >= inf_index + 2) {
-						for (j = indices.size() - 2; j != n; j = back_ptr[j])
-							if (sums[indices[j].first] < left) {
-								found = true;
-								back_ptr.back() = j;
-								break;
-							}
-					}
-				}
-				if (found && sums[indices[j].second + 1] < sums[indices.back().second + 1]) {
-					indices[j].second = i;
-					indices.resize(j + 1);
-					back_ptr.resize(j + 1);
+				while (!stack.empty() && !(sums[stack.back().first] < sums[current.first]))
+					stack.pop_back();
+				if (!stack.empty() && sums[stack.back().second + 1] < sums[current.second + 1]) {
+					current.first = stack.back().first;
+					stack.pop_back();
 				} else {
-					if (!found) {
-						inf_index = indices.size() - 1;
-					}
 					break;
 				}
 			}
+			segment_end[current.first] = current.second;
+			stack.push_back(current);
 		}
 	}
 
-#if 0
-	for (size_t l = 0; l < indices.size(); l++) {
-		printf("%zu - [%zu, %zu] => {%lf, %lf}\n", l, indices[l].first, indices[l].second,
-			sums[indices[l].first], sums[indices[l].second + 1]);
+	for (size_t i = 0; i < n;) {
+		if (segment_end[i] < n) {
+			indices.push_back(make_pair(i, segment_end[i]));
+			i = segment_end[i] + 1;
+		} else {
+			i++;
+		}
 	}
-#endif
+
+	for (size_t l = 0; l < indices.size(); l++)
+		TRACE(TRACE_DISCREPANCY, TRACE_LEVEL_CANDIDATES, TRACE_DISCREPANCY_SEGMENT,
+			(double) l, (double) indices[l].first, (double) indices[l].second,
+			sums[indices[l].first], sums[indices[l].second + 1]);
 }
 
 void analyze_burstiness(const double *series, size_t num_elems,
-	vector<double> &bursty_sums, vector< pair<size_t, size_t> > &indices)
+	vector<double> &bursty_sums, discrepancy_workspace &workspace)
 {
-	double burstiness[MAX_YEARS];
+	vector<double> &burstiness = workspace.burstiness;
 	double sum = 0.0;
 
 	for (size_t i = 0; i < num_elems; i++)
 		sum += series[i];
 
+	burstiness.resize(num_elems);
 	for (size_t i = 0; i < num_elems; i++)
 		burstiness[i] = series[i] / sum - 1. / num_elems;
 
-	bursty_sums.clear();
-	compute_max_sequences(burstiness, num_elems, bursty_sums, indices);
+	workspace.indices.clear();
+	compute_max_sequences(&burstiness[0], num_elems, bursty_sums,
+		workspace.stack, workspace.segment_end, workspace.indices);
+}
+
+void fit_discrepancy(const double *series, unsigned int smoothing_window,
+	vector< pair< pair<size_t, size_t>, double > > &intervals)
+{
+	discrepancy_workspace workspace;
+
+	fit_discrepancy(series, smoothing_window, workspace, intervals);
 }
 
+/*
+ * Intervals of at least 32 years are refined by analyzing them again on their
+ * own, but scored against the burstiness of the whole series. Each refinement
+ * works on a range which is disjoint from the others at its level, so a level
+ * costs linear time overall and the buffers of the workspace are reused.
+ */
 void fit_discrepancy(const double *series, unsigned int smoothing_window,
+	discrepancy_workspace &workspace,
 	vector< pair< pair<size_t, size_t>, double > > &intervals)
 {
-	vector< pair<size_t, size_t> > indices;
-	vector<double> sums, lesser_sums;
+	vector< pair<size_t, size_t> > &pending = workspace.pending;
+	vector<double> &sums = workspace.sums;
 
 	size_t inf = smoothing_window;
 	size_t sup = MAX_YEARS - smoothing_window;
-	analyze_burstiness(series + inf, sup - inf, sums, indices);
-	append_indices(indices, intervals, inf, sums, inf);
+	analyze_burstiness(series + inf, sup - inf, sums, workspace);
 
-	for (size_t i = 0; i < intervals.size();) {
-		size_t diff = intervals[i].first.second - intervals[i].first.first + 1;
-		if (diff >= 32) {
-			size_t sub_inf = intervals[i].first.first;
-			intervals[i] = intervals.back();
-			intervals.pop_back();
+	pending.clear();
+	for (size_t i = 0; i < workspace.indices.size(); i++)
+		pending.push_back(add_to_pair(workspace.indices[i], inf));
+
+	while (!pending.empty()) {
+		pair<size_t, size_t> interval = pending.back();
+		pending.pop_back();
 
-			indices.clear();
-			analyze_burstiness(series + sub_inf, diff, lesser_sums, indices);
-			append_indices(indices, intervals, sub_inf, sums, inf);
+		size_t diff = interval.second - interval.first + 1;
+		if (diff >= 32) {
+			size_t sub_inf = interval.first;
+			analyze_burstiness(series + sub_inf, diff, workspace.lesser_sums, workspace);
+			for (size_t i = 0; i < workspace.indices.size(); i++)
+				pending.push_back(add_to_pair(workspace.indices[i], sub_inf));
 		} else {
-			i++;
+			double score = sums[interval.second + 1 - inf] - sums[interval.first - inf];
+			intervals.push_back(make_pair(interval, score));
 		}
 	}
 }
 
+static const int score_thresholds[] = {
+	1574, 1752, 1817, 1860, 1894, 1924, 1950, 1974, 2005, 2038,
+};
+
 int compute_discrepancy_score(pair<size_t, size_t> interval, double burstiness)
 {
-	const int thresholds[] = {
-		1574, 1752, 1817, 1860, 1894, 1924, 1950, 1974, 2005, 2038,
-	};
 	size_t i;
 	int base = (int) (100 * log(burstiness) + 2076);
-	for (i = 0; i < sizeof(thresholds) / sizeof(*thresholds); i++)
-		if (base < thresholds[i])
+	for (i = 0; i < sizeof(score_thresholds) / sizeof(*score_thresholds); i++)
+		if (base < score_thresholds[i])
 			break;
 	return (int) i;
 }
 
-numerical_discrepancy_processor::numerical_discrepancy_processor(double *series, const char *filename)
-	: series(series), efile(filename) { }
+/*
+ * An interval scores the sum of x / S - 1 / n over its years, which is at
+ * most the positive part of the whole sum, i.e. half the mean absolute
+ * deviation over the mean, itself at most sigma / (2 * mean). Below the
+ * burstiness of the first threshold (with a margin for the rounding of the
+ * base) nothing can score. A series without a positive mean is not bounded.
+ */
+bool discrepancy_admissible(const series_statistics &stats)
+{
+	const double min_burstiness = exp((score_thresholds[0] - 2076 - 1) / 100.0);
 
-numerical_discrepancy_processor::~numerical_discrepancy_processor() { }
+	if (!(stats.mean > 0.0))
+		return true;
+	return !(sqrt(stats.variance) / (2 * stats.mean) < min_burstiness);
+}
+
+numerical_discrepancy_processor::numerical_discrepancy_processor(double *series,
+	series_screen &screen, const char *filename, relevance_format format)
+	: series(series), screen(screen), workspace(), efile(filename)
+{
+	if (init_relevance_matrix(&matrix, efile.f, format, MAX_YEARS) != 0)
+		throw file_exception();
+	if (sink.open(efile.f) != 0)
+		throw file_exception();
+}
+
+numerical_discrepancy_processor::~numerical_discrepancy_processor()
+{
+	finish_relevance_matrix(&matrix);
+}
 
 void numerical_discrepancy_processor::compute_relevance(const char *word)
 {
-	vector< pair< pair<size_t, size_t>, double > > intervals;
+	vector< pair< pair<size_t, size_t>, double > > &intervals = workspace.intervals;
 	int counts[MAX_YEARS];
 
-	fit_discrepancy(series, 2, intervals);
+	intervals.clear();
+	if (screen.admits(SCREEN_DISCREPANCY))
+		fit_discrepancy(series, 2, workspace, intervals);
 	memset(counts, 0, sizeof(counts));
 	for (size_t i = 0; i < intervals.size(); i++) {
 		pair<size_t, size_t> interval = intervals[i].first;
@@ -157,29 +199,41 @@ void numerical_discrepancy_processor::compute_relevance(const char *word)
 		}
 	}
 
-	print_relevance_csv(efile.f, word, counts, MAX_YEARS);
+	if (matrix.format == RELEVANCE_CSV)
+		print_relevance_csv(efile.f, word, counts, MAX_YEARS);
+	else
+		append_relevance_row(&matrix, counts);
 }
 
 void numerical_discrepancy_processor::compute_summary(const char *word)
 {
-	vector< pair< pair<size_t, size_t>, double > > intervals;
+	vector< pair< pair<size_t, size_t>, double > > &intervals = workspace.intervals;
 
-	fit_discrepancy(series, 2, intervals);
+	intervals.clear();
+	if (screen.admits(SCREEN_DISCREPANCY))
+		fit_discrepancy(series, 2, workspace, intervals);
 	sort(intervals.begin(), intervals.end());
+	sink.begin_word(word);
 	for (size_t i = 0; i < intervals.size(); i++) {
 		pair<size_t, size_t> interval = intervals[i].first;
 		int score = compute_discrepancy_score(interval, intervals[i].second);
 		if (score > 0) {
 			for (size_t j = interval.first; j <= interval.second; j++)
-				print_summary_txt(efile.f, word, (unsigned int) j, score);
+				sink.append((unsigned int) j, score);
 		}
 	}
 }
 
-numerical_discrepancy_processor * numerical_discrepancy_processor::create(double *series, const char *filename)
+void numerical_discrepancy_processor::attach_index(event_index *index)
+{
+	sink.attach_index(index);
+}
+
+numerical_discrepancy_processor * numerical_discrepancy_processor::create(double *series,
+	series_screen &screen, const char *filename, relevance_format format)
 {
 	try {
-		return new numerical_discrepancy_processor(series, filename);
+		return new numerical_discrepancy_processor(series, screen, filename, format);
 	} catch (file_exception &fe) {
 		return NULL;
 	}
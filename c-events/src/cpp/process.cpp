@@ -1,52 +1,87 @@
 #include <algorithm>
 #include <limits>
+#include <string>
 #include <vector>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include "dictionary_reader.h"
 #include "dictionary_types.h"
+#include "double_change.h"
+#include "event_index.h"
 #include "gaussian_finder.h"
 #include "gaussian_model.h"
 #include "kleinberg.h"
 #include "numerical_discrepancy.h"
 #include "linear_model.h"
+#include "screening.h"
 #include "series.h"
+#include "series_store.h"
+#include "stage_metrics.h"
+#include "summary_sink.h"
+#include "trace.h"
 #include "util.h"
+#include "word_selection.h"
 
 using namespace std;
 
-void process_series_double_change(const char *word,
-	const double *series, FILE *zeitgeist)
+const char *zeitgeist_directory = "data/zeitgeist/";
+const char *summary_directory = "data/zeitgeist/summary/";
+/* Where a targeted run writes, leaving the summaries of the whole dictionary alone */
+const char *selection_directory = "data/zeitgeist/selection/";
+const char *selection_summary_directory = "data/zeitgeist/selection/summary/";
+
+typedef int (event_index::*event_index_writer)(FILE *f) const;
+
+int write_event_file(const event_index &index, event_index_writer writer,
+	const string &filename)
 {
-	for (int j = 2; j < MAX_YEARS - 2; j++) {
-		double a = series[j - 1];
-		double b = series[j];
-		double c = series[j + 1];
-		if (a >= 0 && b >= 1e-4 && c >= 0) {
-			int count = 0;
-			while (count <= 8) {
-				double sup_ratio = 1.0 + 0.1 * (count + 1);
-				double dsup_ratio = 1.0 + 0.2 * (count + 1);
-				double inf_ratio = 1.0 - 0.1 * (count + 1);
-				double dinf_ratio = 1 / dsup_ratio;
-				if ((b > sup_ratio * a && c > sup_ratio * b) || b > dsup_ratio * a ||
-						(b < inf_ratio * a && c < inf_ratio * b) || b < dinf_ratio * a) {
-					++count;
-				} else {
-					break;
-				}
-			}
-			if (count > 0)
-				fprintf(zeitgeist, "%s\t%d\t%d\n", word, j, count);
-		}
-	}
+	FILE *f = fopen(filename.c_str(), "wb");
+	if (f == NULL)
+		return -1;
+
+	int err = (index.*writer)(f);
+	if (fclose(f) != 0)
+		err = -1;
+	return err;
 }
 
-void process_series_linear_model(const char *word,
-	const gsl_multimin_fdfminimizer_type *T,
-	gsl_multimin_function_fdf *fdf,
-	FILE *zeitgeist)
+/*
+ * Stores the inverted index of a detector next to its summary, along with the
+ * history and revhist documents zeitgeist.py used to build.
+ */
+int write_event_index(const char *name, event_index &index)
+{
+	const string directory = zeitgeist_directory;
+	int err = 0;
+
+	index.finish();
+	if (write_event_file(index, &event_index::write,
+			directory + "index/" + name + "_index.bin") != 0)
+		err = -1;
+	if (write_event_file(index, &event_index::export_history,
+			directory + "history/" + name + "_history.csv") != 0)
+		err = -1;
+	if (write_event_file(index, &event_index::export_revhist,
+			directory + "revhist/" + name + "_revhist.csv") != 0)
+		err = -1;
+	if (err != 0)
+		fprintf(stderr, "Could not write the event index of %s\n", name);
+	return err;
+}
+
+void process_series_double_change(const double *series, summary_sink &zeitgeist)
+{
+	int counts[MAX_YEARS];
+
+	double_change_scores(series, counts);
+	for (int j = 2; j < MAX_YEARS - 2; j++)
+		if (counts[j] > 0)
+			zeitgeist.append((unsigned int) j, counts[j]);
+}
+
+void process_series_linear_model(const gsl_multimin_fdfminimizer_type *T,
+	gsl_multimin_function_fdf *fdf, summary_sink &zeitgeist)
 {
 	struct static_array ranges;
 	const int score_threshold = 3;
@@ -56,26 +91,26 @@ void process_series_linear_model(const char *word,
 		const struct range_entry *entry = &ranges.array[i];
 		double score = -log(fabs(entry->slope));
 		score = 2 * (score_threshold - score);
+		TRACE(TRACE_LINEAR_MODEL, TRACE_LEVEL_EVENTS, TRACE_LINEAR_RANGE,
+			(double) entry->left, (double) entry->right, (double) max((int) score, 0), score,
+			entry->slope);
 		if (score >= 1.0) {
 			for (size_t j = entry->left; j <= entry->right; j++)
-				fprintf(zeitgeist, "%s\t%lu\t%d\n", word,
-					(unsigned long) j, (int) score);
+				zeitgeist.append((unsigned int) j, (int) score);
 		}
 	}
 }
 
-void fit_gaussians(const char *word, const double *series, size_t inf, size_t sup,
-	double widening, FILE *zeitgeist)
+void fit_gaussians(const vector<gaussian_entry> &picked,
+	double widening, summary_sink &zeitgeist)
 {
-	vector<gaussian_entry> gaussians;
 	vector< pair<size_t, int> > relevant_counts;
 
-	select_gaussians(series, inf, sup, gaussians);
-	relevant_gaussians(gaussians, relevant_counts, widening);
+	widen_gaussians(picked, relevant_counts, widening);
 	for (vector< pair<size_t, int> >::iterator it = relevant_counts.begin(); it != relevant_counts.end(); ++it) {
 		size_t year = it->first;
 		int count = it->second;
-		fprintf(zeitgeist, "%s\t%u\t%d\n", word, (unsigned int) year, count);
+		zeitgeist.append((unsigned int) year, count);
 	}
 }
 
@@ -89,23 +124,63 @@ unsigned int compute_max_num_docs(const struct dictionary_reader *dictreader)
 	return max_num_docs;
 }
 
-int main()
+/*
+ * Usage: process [--dictionary BASE] [--series-store] [--word-ids] [--compressed]
+ *	[--min-gaussian-burstiness B] [--min-linear-burstiness B]
+ *	[--words FILE] [--regex PATTERN]
+ *	[--prefix PREFIX] [--min-count N] [--max-count N] [--top-bursty N] [...]
+ * Without selection options, summarizes the frequent words without a part of
+ * speech. Otherwise only the selected words are read, in the order of the
+ * time file; the criteria on the word statistics (see parse_word_selection)
+ * are checked against the .stats of the dictionary, before any table is read.
+ * A targeted run writes its summaries, indexes, history and revhist in
+ * data/zeitgeist/selection, replacing those of the previous targeted run.
+ *
+ * --dictionary reads another sorted dictionary, such as the one extractor
+ * writes with only the frequent words. --series-store reads the series from
+ * the .series series_builder made of the dictionary rather than from the
+ * tables, which log16 stores only approximate. --word-ids writes every word
+ * of a summary once, in a .ids file next to it, which runs without the flag
+ * remove; --compressed writes the summaries as zstd streams (.txt.zst). The
+ * burstiness thresholds skip the Gaussians and the linear model on flatter
+ * series, trading recall for speed; by default only the words which cannot
+ * have an event are skipped.
+ */
+int main(int argc, char **argv)
 {
-	const char *summary_filenames[] = {
-		"data/zeitgeist/summary/double_change_summary.txt",
-		"data/zeitgeist/summary/linear_model_summary.txt",
-		"data/zeitgeist/summary/s1_gaussian_summary.txt",
-		"data/zeitgeist/summary/s2_gaussian_summary.txt",
-		"data/zeitgeist/summary/s3_gaussian_summary.txt",
-		"data/zeitgeist/summary/sinf_gaussian_summary.txt",
+	const char *summary_names[] = {
+		"double_change",
+		"linear_model",
+		"s1_gaussian",
+		"s2_gaussian",
+		"s3_gaussian",
+		"sinf_gaussian",
 	};
 	const double parameters[] = {
 		1.0, 2.0, 3.0, numeric_limits<double>::max()
 	};
-	FILE *zeitgeists[sizeof(summary_filenames) / sizeof(*summary_filenames)];
+	const char *processor_names[] = {
+		"numerical_discrepancy",
+		"kleinberg",
+	};
+	/* Ids in the summaries, listed in a side file, and zstd streams */
+	bool word_ids = false;
+	bool compressed = false;
+	bool use_store = false;
+	const size_t num_summaries = sizeof(summary_names) / sizeof(*summary_names);
+	const size_t num_processors = sizeof(processor_names) / sizeof(*processor_names);
+	FILE *summary_files[num_summaries];
+	FILE *word_files[num_summaries];
+	summary_sink zeitgeists[num_summaries];
+	vector<event_index> indexes(num_summaries + num_processors, event_index(MAX_YEARS));
+	bool indexed[num_summaries + num_processors];
+	numerical_discrepancy_processor *discrepancy;
+	kleinberg_processor *kleinberg;
 	vector<generic_processor *> processors;
+	vector<pipeline_stage> processor_stages;
 	vector<unsigned int> docs;
 	vector<unsigned int> relevant(MAX_YEARS);
+	vector<gaussian_entry> gaussians, picked;
 
 	const gsl_multimin_fdfminimizer_type *T;
 	gsl_multimin_function_fdf regression_func;
@@ -113,7 +188,10 @@ int main()
 	struct time_entry table[MAX_YEARS];
 	double series[MAX_YEARS];
 	double smooth_series[MAX_YEARS];
+	const char *base_filename = "data/sort/googlebooks-eng-all-1gram-20120701-database";
 	struct dictionary_reader dict;
+	struct series_store store;
+	bool has_store, need_tables;
 	size_t num_read;
 	const unsigned int smoothing_window = 2;
 #if 1
@@ -123,7 +201,13 @@ int main()
 	struct static_range training_data = { 0, 300, 1700,
 		smooth_series + 200, 300 };
 #endif
-	size_t percent = 0;
+	struct screening_thresholds thresholds = { 0.0, 0.0 };
+	series_screen screen(thresholds);
+	struct word_selection selection;
+	vector<char *> selection_args(1, argv[0]);
+	size_t *selected = NULL;
+	size_t num_selected;
+	stage_metrics metrics;
 	int err = 0;
 
 	T = gsl_multimin_fdfminimizer_conjugate_pr;
@@ -134,24 +218,110 @@ int main()
 	regression_func.fdf = regression_fdf;
 	regression_func.params = &training_data;
 
-	err = init_dictreader(&dict, "data/sort/googlebooks-eng-all-1gram-20120701-database");
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--dictionary") == 0 && i + 1 < argc)
+			base_filename = argv[++i];
+		else if (strcmp(argv[i], "--min-gaussian-burstiness") == 0 && i + 1 < argc)
+			thresholds.min_gaussian_burstiness = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--min-linear-burstiness") == 0 && i + 1 < argc)
+			thresholds.min_linear_model_burstiness = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--series-store") == 0)
+			use_store = true;
+		else if (strcmp(argv[i], "--word-ids") == 0)
+			word_ids = true;
+		else if (strcmp(argv[i], "--compressed") == 0)
+			compressed = true;
+		else
+			selection_args.push_back(argv[i]);
+	}
+	screen.set_thresholds(thresholds);
+#ifndef HAVE_ZSTD
+	if (compressed) {
+		fprintf(stderr, "Compressed summaries need a build with make ZSTD=1\n");
+		err = 1;
+		goto out;
+	}
+#endif
+	init_word_selection(&selection);
+	err = parse_word_selection(&selection, (int) selection_args.size(), &selection_args[0]);
 	if (err != 0)
 		goto out;
 
-	maybe_add_pointer<generic_processor>(processors, numerical_discrepancy_processor::create(smooth_series, "data/zeitgeist/summary/numerical_discrepancy_summary.txt"));
-	maybe_add_pointer<generic_processor>(processors, kleinberg_processor::create(docs, relevant, "data/zeitgeist/summary/kleinberg_summary.txt"));
+	err = init_dictreader(&dict, base_filename);
+	if (err != 0)
+		goto out;
+	has_store = use_store && open_dictionary_series(&store, base_filename, dict.num_words,
+		smoothing_window) == 0;
+
+	num_selected = dict.num_words;
+	if (!is_word_selection_empty(&selection)) {
+		err = select_words(&dict, &selection, &selected, &num_selected);
+		if (err != 0)
+			goto out_reader;
+		printf("Selected %lu words\n", (unsigned long) num_selected);
+		zeitgeist_directory = selection_directory;
+		summary_directory = selection_summary_directory;
+		make_directory(zeitgeist_directory);
+		make_directory(summary_directory);
+	}
+
+	memset(indexed, 0, sizeof(indexed));
+	discrepancy = numerical_discrepancy_processor::create(smooth_series, screen,
+		(string(summary_directory) + "numerical_discrepancy_summary.txt").c_str());
+	if (discrepancy != NULL) {
+		discrepancy->attach_index(&indexes[num_summaries]);
+		indexed[num_summaries] = true;
+	}
+	kleinberg = kleinberg_processor::create(docs, relevant,
+		(string(summary_directory) + "kleinberg_summary.txt").c_str());
+	if (kleinberg != NULL) {
+		kleinberg->attach_index(&indexes[num_summaries + 1]);
+		indexed[num_summaries + 1] = true;
+	}
+	maybe_add_pointer<generic_processor>(processors, discrepancy);
+	maybe_add_pointer<generic_processor>(processors, kleinberg);
+	if (discrepancy != NULL)
+		processor_stages.push_back(STAGE_DISCREPANCY);
+	if (kleinberg != NULL)
+		processor_stages.push_back(STAGE_KLEINBERG);
+	/* Only Kleinberg needs the match counts, the others make do with the stored series */
+	need_tables = !has_store || kleinberg != NULL;
+	if (has_store)
+		printf("Reading the %s series from the store%s\n",
+			series_encoding_name((enum series_encoding) store.header->encoding),
+			need_tables ? ", and the tables for Kleinberg" : "");
 
 	for (int i = 0; i < MAX_YEARS; i++) {
 		const struct total_counts_entry *entry = &dict.frequencies[i];
 		docs.push_back(match_total_counts_feature(entry));
 	}
 
-	memset(zeitgeists, 0, sizeof(zeitgeists));
-	for (size_t i = 0; i < sizeof(zeitgeists) / sizeof(*zeitgeists); i++) {
-		if (!file_exists(summary_filenames[i])) {
-			zeitgeists[i] = fopen(summary_filenames[i], "wt");
-			if (zeitgeists[i] == NULL)
+	memset(summary_files, 0, sizeof(summary_files));
+	memset(word_files, 0, sizeof(word_files));
+	for (size_t i = 0; i < num_summaries; i++) {
+		const string base_filename = summary_directory + string(summary_names[i]) + "_summary";
+		const string filename = base_filename + (compressed ? ".txt.zst" : ".txt");
+		/* A targeted run rewrites every summary, so that they all cover the same words */
+		if (selected != NULL || !file_exists(filename.c_str())) {
+			summary_files[i] = fopen(filename.c_str(), "wb");
+			if (summary_files[i] == NULL)
+				goto out_reader;
+			/* zeitgeist.py reads the words through the .ids file whenever there is one */
+			const string ids_filename = base_filename + ".ids";
+			if (word_ids) {
+				word_files[i] = fopen(ids_filename.c_str(), "wb");
+				if (word_files[i] == NULL)
+					goto out_reader;
+			} else if (file_exists(ids_filename.c_str()) && remove(ids_filename.c_str()) != 0) {
+				fprintf(stderr, "Could not remove the stale word ids: %s\n", ids_filename.c_str());
+				err = -1;
+				goto out_reader;
+			}
+			err = zeitgeists[i].open(summary_files[i], word_files[i], compressed);
+			if (err != 0)
 				goto out_reader;
+			zeitgeists[i].attach_index(&indexes[i]);
+			indexed[i] = true;
 		}
 	}
 
@@ -159,47 +329,101 @@ int main()
 	init_ln_sums(compute_max_num_docs(&dict));
 	memset(smooth_series, 0, sizeof(smooth_series));
 
-	for (size_t i = 0; i < dict.num_words; i++) {
-		const char *word = dict.words[i];
-		if (strchr(word, '_') != NULL)
+	metrics.start(num_selected);
+	for (size_t i = 0; i < num_selected; i++) {
+		const size_t index = selected != NULL ? selected[i] : i;
+		const char *word = dict.words[index];
+		if (selected == NULL && strchr(word, '_') != NULL)
 			continue;
-		if (dict.database[i].total_match_count < (1 << 18))
+		if (selected == NULL && dict.database[index].total_match_count < (1 << 18))
 			continue;
-		size_t new_percent = (100 * i) / dict.num_words;
-		if (new_percent > percent) {
-			percent = new_percent;
-			if (percent % 4 == 0)
-				printf("%u%% done\n", (unsigned int) percent);
+		metrics.progress(i);
+		metrics.begin_word();
+		if (need_tables) {
+			err = read_table(&dict, index, table, &num_read);
+			if (err != 0)
+				goto out_reader;
+			metrics.end_stage(STAGE_READ_TABLE);
 		}
-		err = read_table(&dict, i, table, &num_read);
-		if (err != 0)
-			goto out_reader;
 
-		table_to_series(&dict, table, num_read, series);
-		smoothify_series(series, smooth_series, MAX_YEARS, smoothing_window);
-		table_to_feature_counts(table, num_read, &relevant[0], match_time_feature);
+		if (has_store) {
+			series_store_smoothed(&store, index, smoothing_window, series, smooth_series);
+		} else {
+			table_to_series(&dict, table, num_read, series);
+			smoothify_series(series, smooth_series, MAX_YEARS, smoothing_window);
+		}
+		if (need_tables)
+			table_to_feature_counts(table, num_read, &relevant[0], match_time_feature);
+		metrics.end_stage(STAGE_SERIES);
+		screen.screen(smooth_series, smoothing_window, MAX_YEARS - smoothing_window);
+		for (size_t j = 0; j < num_summaries; j++)
+			if (zeitgeists[j].is_open())
+				zeitgeists[j].begin_word(word);
+		TRACE_BEGIN_WORD(word);
+		metrics.end_stage(STAGE_SCREENING);
 
-		if (zeitgeists[0] != NULL)
-			process_series_double_change(word, smooth_series, zeitgeists[0]);
-		if (zeitgeists[1] != NULL)
-			process_series_linear_model(word, T, &regression_func, zeitgeists[1]);
+		if (zeitgeists[0].is_open() && screen.admits(SCREEN_DOUBLE_CHANGE)) {
+			process_series_double_change(smooth_series, zeitgeists[0]);
+			metrics.end_stage(STAGE_DOUBLE_CHANGE);
+		}
+		if (zeitgeists[1].is_open()) {
+			/* The later detectors see the standardized series either way */
+			if (screen.admits(SCREEN_LINEAR_MODEL))
+				process_series_linear_model(T, &regression_func, zeitgeists[1]);
+			else
+				normalize_training_data(&regression_func);
+			screen.series_normalized();
+			metrics.end_stage(STAGE_LINEAR_MODEL);
+		}
+		picked.clear();
+		if ((zeitgeists[2].is_open() || zeitgeists[3].is_open() ||
+				zeitgeists[4].is_open() || zeitgeists[5].is_open()) &&
+				screen.admits(SCREEN_GAUSSIANS)) {
+			select_gaussians(smooth_series, smoothing_window,
+				MAX_YEARS - smoothing_window, gaussians);
+			pick_gaussians(gaussians, picked);
+		}
 		for (size_t j = 0; j < sizeof(parameters) / sizeof(*parameters); j++)
-			if (zeitgeists[j + 2] != NULL) {
-				fit_gaussians(word, smooth_series, smoothing_window,
-					MAX_YEARS - smoothing_window, parameters[j], zeitgeists[j + 2]);
-			}
-		for (vector<generic_processor *>::const_iterator it = processors.begin(); it != processors.end(); ++it)
-			(*it)->compute_summary(word);
+			if (zeitgeists[j + 2].is_open())
+				fit_gaussians(picked, parameters[j], zeitgeists[j + 2]);
+		metrics.end_stage(STAGE_GAUSSIANS);
+		for (size_t j = 0; j < processors.size(); j++) {
+			processors[j]->compute_summary(word);
+			metrics.end_stage(processor_stages[j]);
+		}
+		metrics.end_word(word);
 	}
 
+	screen.print_counters(stdout);
+	metrics.print(stdout);
+
 	for (vector<generic_processor *>::iterator it = processors.begin(); it != processors.end(); ++it)
 		delete *it;
 
+	make_directory((string(zeitgeist_directory) + "index").c_str());
+	make_directory((string(zeitgeist_directory) + "history").c_str());
+	make_directory((string(zeitgeist_directory) + "revhist").c_str());
+	for (size_t i = 0; i < num_summaries + num_processors; i++) {
+		const char *name = i < num_summaries ? summary_names[i] : processor_names[i - num_summaries];
+		if (indexed[i] && write_event_index(name, indexes[i]) != 0)
+			err = -1;
+	}
+
 out_reader:
+	free(selected);
+	if (has_store)
+		close_series_store(&store);
 	destroy_dictreader(&dict);
-	for (size_t i = 0; i < sizeof(zeitgeists) / sizeof(*zeitgeists); i++)
-		if (zeitgeists[i] != NULL)
-			fclose(zeitgeists[i]);
+	for (size_t i = 0; i < num_summaries; i++) {
+		if (zeitgeists[i].close() != 0 && err == 0) {
+			fprintf(stderr, "Could not write the %s summary\n", summary_names[i]);
+			err = -1;
+		}
+		if (summary_files[i] != NULL)
+			fclose(summary_files[i]);
+		if (word_files[i] != NULL)
+			fclose(word_files[i]);
+	}
 
 out:
 	return err;
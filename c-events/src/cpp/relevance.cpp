@@ -1,76 +1,55 @@
 #include <algorithm>
 #include <limits>
+#include <string>
 #include <vector>
 #include <cstdlib>
 #include <cstring>
 #include "dictionary_reader.h"
 #include "dictionary_types.h"
+#include "double_change.h"
 #include "generic_processor.h"
 #include "gaussian_finder.h"
 #include "gaussian_model.h"
 #include "kleinberg.h"
 #include "numerical_discrepancy.h"
 #include "linear_model.h"
+#include "relevance_matrix.h"
+#include "screening.h"
 #include "series.h"
+#include "series_store.h"
+#include "stage_metrics.h"
+#include "trace.h"
 #include "util.h"
+#include "word_selection.h"
 #include "file.h"
 
 using namespace std;
 
-void append_csv(FILE *f, const char *word,
-	const int *counts, size_t num_elems)
+const char *relevance_directory = "data/relevance/";
+
+string relevance_filename(const char *name, relevance_format format)
 {
-	if (f == NULL)
-		return;
-
-	(void) word;
-#if 0
-	fprintf(f, "\"%s\"", word);
-	for (size_t i = 0; i < num_elems; i++)
-		fprintf(f, ",%d", counts[i]);
-#else
-	for (size_t i = 0; i < num_elems; i++) {
-		if (i > 0)
-			fprintf(f, ",");
-		fprintf(f, "%d", counts[i]);
-	}
-#endif
-	fprintf(f, "\n");
+	return relevance_directory + string(name) + relevance_format_extension(format);
 }
 
-void double_change_series_to_csv(const char *word, double *series, FILE *relevance_file)
+void append_empty_row(struct relevance_matrix *matrix)
 {
 	int counts[MAX_YEARS];
 
 	memset(counts, 0, sizeof(counts));
-	for (int j = 2; j < MAX_YEARS - 2; j++) {
-		double a = series[j - 1];
-		double b = series[j];
-		double c = series[j + 1];
-		if (a >= 0 && b >= 1e-4 && c >= 0) {
-			int count = 0;
-			while (count <= 8) {
-				double sup_ratio = 1.0 + 0.1 * (count + 1);
-				double dsup_ratio = 1.0 + 0.2 * (count + 1);
-				double inf_ratio = 1.0 - 0.1 * (count + 1);
-				double dinf_ratio = 1 / dsup_ratio;
-				if ((b > sup_ratio * a && c > sup_ratio * b) || b > dsup_ratio * a ||
-						(b < inf_ratio * a && c < inf_ratio * b) || b < dinf_ratio * a) {
-					++count;
-				} else {
-					break;
-				}
-			}
-			counts[j] = count;
-		}
-	}
+	append_relevance_row(matrix, counts);
+}
 
-	append_csv(relevance_file, word, counts, MAX_YEARS);
+void double_change_series_to_matrix(double *series, struct relevance_matrix *matrix)
+{
+	int counts[MAX_YEARS];
+
+	double_change_scores(series, counts);
+	append_relevance_row(matrix, counts);
 }
 
-void linear_model_series_to_csv(const char *word,
-	const gsl_multimin_fdfminimizer_type *T,
-	gsl_multimin_function_fdf *fdf, FILE *relevance_file)
+void linear_model_series_to_matrix(const gsl_multimin_fdfminimizer_type *T,
+	gsl_multimin_function_fdf *fdf, struct relevance_matrix *matrix)
 {
 	int counts[MAX_YEARS];
 	struct static_array ranges;
@@ -83,24 +62,23 @@ void linear_model_series_to_csv(const char *word,
 		double score = -log(fabs(entry->slope));
 		score = 2 * (score_threshold - score);
 		int count = (int) score;
-#if 0
-		printf("%zu-%zu : %d (score=%lf slope=%lf)\n", entry->left, entry->right,
-			count > 0 ? count : 0, score, entry->slope);
-#endif
+		TRACE(TRACE_LINEAR_MODEL, TRACE_LEVEL_EVENTS, TRACE_LINEAR_RANGE,
+			(double) entry->left, (double) entry->right, (double) max(count, 0), score,
+			entry->slope);
 		if (count > 0) {
 			for (size_t j = entry->left; j <= entry->right; j++)
 				counts[j - MIN_YEAR] = count;
 		}
 	}
 
-	append_csv(relevance_file, word, counts, MAX_YEARS);
+	append_relevance_row(matrix, counts);
 }
 
-void fit_gaussians(const vector<gaussian_entry> &gaussians, double widening, int *counts)
+void fit_gaussians(const vector<gaussian_entry> &picked, double widening, int *counts)
 {
 	vector< pair<size_t, int> > relevant_counts;
 
-	relevant_gaussians(gaussians, relevant_counts, widening);
+	widen_gaussians(picked, relevant_counts, widening);
 	for (vector< pair<size_t, int> >::iterator it = relevant_counts.begin(); it != relevant_counts.end(); ++it) {
 		size_t year = it->first;
 		int count = it->second;
@@ -108,28 +86,31 @@ void fit_gaussians(const vector<gaussian_entry> &gaussians, double widening, int
 	}
 }
 
-void gaussian_model_series_to_csv(const char *word, const double *series, FILE *relevance_files[])
+void gaussian_model_series_to_matrix(const double *series, struct relevance_matrix matrices[])
 {
 	const double parameters[] = {
 		1.0, 2.0, 3.0, numeric_limits<double>::max()
 	};
-	vector<gaussian_entry> gaussians;
+	vector<gaussian_entry> gaussians, picked;
 	int counts[MAX_YEARS];
 
 	select_gaussians(series, 2, MAX_YEARS - 2, gaussians);
+	pick_gaussians(gaussians, picked);
 
 	for (size_t i = 0; i < sizeof(parameters) / sizeof(*parameters); i++) {
 		memset(counts, 0, sizeof(counts));
-		fit_gaussians(gaussians, parameters[i], counts);
-		append_csv(relevance_files[i], word, counts, MAX_YEARS);
+		fit_gaussians(picked, parameters[i], counts);
+		append_relevance_row(&matrices[i], counts);
 	}
 }
 
 int handle_entry(const struct dictionary_reader *dictreader, size_t index,
 	const gsl_multimin_fdfminimizer_type *T,
 	gsl_multimin_function_fdf regression_func,
-	double *smooth_series, vector<unsigned int> &relevant, FILE *relevance_files[],
-	vector<generic_processor *> processors)
+	double *smooth_series, vector<unsigned int> &relevant, series_screen &screen,
+	struct relevance_matrix matrices[],
+	const vector<generic_processor *> &processors, const vector<pipeline_stage> &processor_stages,
+	const struct series_store *store, bool need_tables, stage_metrics &metrics)
 {
 	struct time_entry table[MAX_YEARS];
 	double series[MAX_YEARS];
@@ -138,32 +119,80 @@ int handle_entry(const struct dictionary_reader *dictreader, size_t index,
 	int err;
 	const unsigned int smoothing_window = 2;
 
-	err = read_table(dictreader, index, table, &table_size);
+	metrics.begin_word();
+	err = need_tables ? read_table(dictreader, index, table, &table_size) : 0;
 	if (err == 0) {
-		table_to_series(dictreader, table, table_size, series);
-		smoothify_series(series, smooth_series, MAX_YEARS, smoothing_window);
-		table_to_feature_counts(table, table_size, &relevant[0], match_time_feature);
+		if (need_tables)
+			metrics.end_stage(STAGE_READ_TABLE);
+		if (store != NULL) {
+			series_store_smoothed(store, index, smoothing_window, series, smooth_series);
+		} else {
+			table_to_series(dictreader, table, table_size, series);
+			smoothify_series(series, smooth_series, MAX_YEARS, smoothing_window);
+		}
+		if (need_tables)
+			table_to_feature_counts(table, table_size, &relevant[0], match_time_feature);
+		metrics.end_stage(STAGE_SERIES);
+		screen.screen(smooth_series, smoothing_window, MAX_YEARS - smoothing_window);
+		metrics.end_stage(STAGE_SCREENING);
 
 		word = dictreader->words[index];
-		if (relevance_files[0] != NULL)
-			double_change_series_to_csv(word, smooth_series, relevance_files[0]);
-		if (relevance_files[1] != NULL)
-			linear_model_series_to_csv(word, T, &regression_func, relevance_files[1]);
-		if (relevance_files[2] != NULL || relevance_files[3] != NULL ||
-				relevance_files[4] != NULL || relevance_files[5] != NULL) {
-			gaussian_model_series_to_csv(word, smooth_series, &relevance_files[2]);
+		TRACE_BEGIN_WORD(word);
+		if (matrices[0].f != NULL) {
+			if (screen.admits(SCREEN_DOUBLE_CHANGE))
+				double_change_series_to_matrix(smooth_series, &matrices[0]);
+			else
+				append_empty_row(&matrices[0]);
+			metrics.end_stage(STAGE_DOUBLE_CHANGE);
 		}
-		for (vector<generic_processor *>::const_iterator it = processors.begin(); it != processors.end(); ++it)
-			(*it)->compute_relevance(word);
+		if (matrices[1].f != NULL) {
+			/* The later detectors see the standardized series either way */
+			if (screen.admits(SCREEN_LINEAR_MODEL)) {
+				linear_model_series_to_matrix(T, &regression_func, &matrices[1]);
+			} else {
+				normalize_training_data(&regression_func);
+				append_empty_row(&matrices[1]);
+			}
+			screen.series_normalized();
+			metrics.end_stage(STAGE_LINEAR_MODEL);
+		}
+		if (matrices[2].f != NULL || matrices[3].f != NULL ||
+				matrices[4].f != NULL || matrices[5].f != NULL) {
+			if (screen.admits(SCREEN_GAUSSIANS)) {
+				gaussian_model_series_to_matrix(smooth_series, &matrices[2]);
+			} else {
+				for (size_t i = 2; i < 6; i++)
+					append_empty_row(&matrices[i]);
+			}
+			metrics.end_stage(STAGE_GAUSSIANS);
+		}
+		for (size_t i = 0; i < processors.size(); i++) {
+			processors[i]->compute_relevance(word);
+			metrics.end_stage(processor_stages[i]);
+		}
+		metrics.end_word(word);
 	}
 	return err;
 }
 
-int string_compare(const void *a, const void *b)
+/* Names the dictionary word of every row of a targeted run */
+int write_selected_words(const struct dictionary_reader *dictreader, const size_t *selected,
+	size_t num_selected, const string &filename)
 {
-	const char **x = (const char **) a;
-	const char **y = (const char **) b;
-	return strcmp(*x, *y);
+	FILE *f = fopen(filename.c_str(), "wt");
+	int err = 0;
+
+	if (f == NULL) {
+		fprintf(stderr, "Could not open for writing: %s\n", filename.c_str());
+		return 1;
+	}
+	for (size_t i = 0; i < num_selected && err == 0; i++) {
+		if (fprintf(f, "%lu\t%s\n", (unsigned long) selected[i], dictreader->words[selected[i]]) < 0)
+			err = 1;
+	}
+	if (fclose(f) != 0)
+		err = 1;
+	return err;
 }
 
 unsigned int compute_max_num_docs(const struct dictionary_reader *dictreader)
@@ -176,59 +205,56 @@ unsigned int compute_max_num_docs(const struct dictionary_reader *dictreader)
 	return max_num_docs;
 }
 
-int main()
+/*
+ * Usage: relevance [--series-store]
+ *	[--min-gaussian-burstiness B] [--min-linear-burstiness B]
+ *	[--words FILE] [--regex PATTERN] [--prefix PREFIX]
+ *	[--min-count N] [--max-count N] [--top-bursty N] [...]
+ * Without options, writes one row per dictionary word in data/relevance.
+ * A targeted run only reads and scores the selected words, and writes
+ * their rows in data/relevance/selection, along with words.txt which gives
+ * the dictionary index and the word of each row, replacing every matrix of
+ * the previous targeted run. The burstiness thresholds and --series-store
+ * are those of process.
+ */
+int main(int argc, char **argv)
 {
 	const gsl_multimin_fdfminimizer_type *T;
 	gsl_multimin_function_fdf regression_func;
 
 	double smooth_series[MAX_YEARS];
+	const char *base_filename = "data/sort/googlebooks-eng-all-1gram-20120701-database";
 	struct dictionary_reader dict;
+	struct series_store store;
+	bool has_store, need_tables;
+	bool use_store = false;
 	const unsigned int smoothing_window = 2;
 	struct static_range training_data = { 0, MAX_YEARS, 1500 + smoothing_window,
 		smooth_series + smoothing_window, MAX_YEARS - 2 * smoothing_window };
+	struct screening_thresholds thresholds = { 0.0, 0.0 };
+	series_screen screen(thresholds);
 	int err = 0;
-	const char *words[] = {
-		"war",
-		"Microsoft",
-#if 1
-		"women",
-		"communism",
-		"atomic",
-		"trench",
-		"plague",
-		"bomb",
-		"Vietnam",
-		"slavery",
-		"famine",
-		"Cuba",
-		"terrorism",
-		"assassination",
-		"genocide",
-		"revolution",
-		"attack",
-		"rebel",
-		"fascism",
-		"siege",
-		"battle",
-		"secession",
-		"bombing",
-		"Ceaucescu",
-		"Jew",
-#endif
+	struct word_selection selection;
+	vector<char *> selection_args(1, argv[0]);
+	size_t *selected = NULL;
+	size_t num_selected;
+	stage_metrics metrics;
+	const relevance_format format = RELEVANCE_CSR;
+	const char *names[] = {
+		"double_change",
+		"linear_model",
+		"s1_gaussian",
+		"s2_gaussian",
+		"s3_gaussian",
+		"sinf_gaussian",
 	};
-	size_t percent = 0;
-	const char *filenames[] = {
-		"data/relevance/double_change.csv",
-		"data/relevance/linear_model.csv",
-		"data/relevance/s1_gaussian.csv",
-		"data/relevance/s2_gaussian.csv",
-		"data/relevance/s3_gaussian.csv",
-		"data/relevance/sinf_gaussian.csv",
-	};
-	FILE *relevance_files[sizeof(filenames) / sizeof(*filenames)];
+	FILE *relevance_files[sizeof(names) / sizeof(*names)];
+	struct relevance_matrix matrices[sizeof(names) / sizeof(*names)];
 	vector<unsigned int> docs;
 	vector<unsigned int> relevant(MAX_YEARS);
 	vector<generic_processor *> processors;
+	vector<pipeline_stage> processor_stages;
+	generic_processor *processor;
 
 	T = gsl_multimin_fdfminimizer_conjugate_pr;
 
@@ -238,19 +264,69 @@ int main()
 	regression_func.fdf = regression_fdf;
 	regression_func.params = &training_data;
 
-	err = init_dictreader(&dict, "data/sort/googlebooks-eng-all-1gram-20120701-database");
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--series-store") == 0)
+			use_store = true;
+		else if (strcmp(argv[i], "--min-gaussian-burstiness") == 0 && i + 1 < argc)
+			thresholds.min_gaussian_burstiness = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--min-linear-burstiness") == 0 && i + 1 < argc)
+			thresholds.min_linear_model_burstiness = strtod(argv[++i], NULL);
+		else
+			selection_args.push_back(argv[i]);
+	}
+	screen.set_thresholds(thresholds);
+	init_word_selection(&selection);
+	err = parse_word_selection(&selection, (int) selection_args.size(), &selection_args[0]);
 	if (err != 0)
 		goto out;
 
-	maybe_add_pointer<generic_processor>(processors, numerical_discrepancy_processor::create(smooth_series, "data/relevance/numerical_discrepancy.csv"));
-	maybe_add_pointer<generic_processor>(processors, kleinberg_processor::create(docs, relevant, "data/relevance/kleinberg.csv"));
+	err = init_dictreader(&dict, base_filename);
+	if (err != 0)
+		goto out;
+	has_store = use_store && open_dictionary_series(&store, base_filename, dict.num_words,
+		smoothing_window) == 0;
+
+	num_selected = dict.num_words;
+	if (!is_word_selection_empty(&selection)) {
+		err = select_words(&dict, &selection, &selected, &num_selected);
+		if (err != 0)
+			goto out_reader;
+		printf("Selected %lu words\n", (unsigned long) num_selected);
+		relevance_directory = "data/relevance/selection/";
+		make_directory(relevance_directory);
+		err = write_selected_words(&dict, selected, num_selected,
+			string(relevance_directory) + "words.txt");
+		if (err != 0)
+			goto out_reader;
+	}
+
+	processor = numerical_discrepancy_processor::create(smooth_series, screen, relevance_filename("numerical_discrepancy", format).c_str(), format);
+	if (processor != NULL)
+		processor_stages.push_back(STAGE_DISCREPANCY);
+	maybe_add_pointer<generic_processor>(processors, processor);
+	processor = kleinberg_processor::create(docs, relevant, relevance_filename("kleinberg", format).c_str(), format);
+	if (processor != NULL)
+		processor_stages.push_back(STAGE_KLEINBERG);
+	maybe_add_pointer<generic_processor>(processors, processor);
+	/* Only Kleinberg needs the match counts, the others make do with the stored series */
+	need_tables = !has_store || processor != NULL;
+	if (has_store)
+		printf("Reading the %s series from the store%s\n",
+			series_encoding_name((enum series_encoding) store.header->encoding),
+			need_tables ? ", and the tables for Kleinberg" : "");
 
 	memset(relevance_files, 0, sizeof(relevance_files));
-	for (size_t i = 0; i < sizeof(filenames) / sizeof(*filenames); i++) {
-		if (!file_exists(filenames[i])) {
-			relevance_files[i] = fopen(filenames[i], "wt");
+	memset(matrices, 0, sizeof(matrices));
+	for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++) {
+		const string filename = relevance_filename(names[i], format);
+		/* A targeted run rewrites every matrix, so that they all have the rows of words.txt */
+		if (selected != NULL || !file_exists(filename.c_str())) {
+			relevance_files[i] = fopen(filename.c_str(), "wb");
 			if (relevance_files[i] == NULL)
 				goto out_files;
+			err = init_relevance_matrix(&matrices[i], relevance_files[i], format, MAX_YEARS);
+			if (err != 0)
+				goto out_files;
 		}
 	}
 
@@ -263,41 +339,35 @@ int main()
 	init_ln_sums(compute_max_num_docs(&dict));
 	memset(smooth_series, 0, sizeof(smooth_series));
 
-#if 0
-	for (size_t i = 0; i < sizeof(words) / sizeof(*words); i++) {
-		void *p = bsearch(&words[i], dict.words, dict.num_words,
-			sizeof(*dict.words), string_compare);
-		if (p != NULL) {
-			char **marker = (char **) p;
-			ptrdiff_t index = marker - dict.words;
-			err = handle_entry(&dict, (size_t) index, T, regression_func, smooth_series, docs, relevant, relevance_files, processors);
-			if (err != 0)
-				goto out_files;
-		}
-	}
-#else
-	for (size_t i = 0; i < dict.num_words; i++) {
-		size_t new_percent = (100 * i) / dict.num_words;
-		if (new_percent > percent) {
-			percent = new_percent;
-			if (percent % 4 == 0)
-				printf("%u%% done\n", (unsigned int) percent);
-		}
-		err = handle_entry(&dict, i, T, regression_func, smooth_series, relevant, relevance_files, processors);
+	metrics.start(num_selected);
+	for (size_t i = 0; i < num_selected; i++) {
+		const size_t index = selected != NULL ? selected[i] : i;
+		metrics.progress(i);
+		err = handle_entry(&dict, index, T, regression_func, smooth_series, relevant, screen, matrices, processors, processor_stages, has_store ? &store : NULL, need_tables, metrics);
 		if (err != 0)
 			goto out_files;
 	}
-#endif
 
-	for (vector<generic_processor *>::iterator it = processors.begin(); it != processors.end(); ++it)
-		delete *it;
+	screen.print_counters(stdout);
+	metrics.print(stdout);
 
 out_files:
+	/* Deleting the processors finishes their matrices */
+	for (vector<generic_processor *>::iterator it = processors.begin(); it != processors.end(); ++it)
+		delete *it;
 	for (size_t i = 0; i < sizeof(relevance_files) / sizeof(*relevance_files); i++) {
+		if (finish_relevance_matrix(&matrices[i]) != 0 && err == 0) {
+			fprintf(stderr, "Could not complete the relevance matrix of %s\n", names[i]);
+			err = -1;
+		}
 		if (relevance_files[i] != NULL)
 			fclose(relevance_files[i]);
 	}
 
+out_reader:
+	free(selected);
+	if (has_store)
+		close_series_store(&store);
 	destroy_dictreader(&dict);
 
 out:
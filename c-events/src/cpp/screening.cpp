@@ -0,0 +1,86 @@
+#include "screening.h"
+#include <cstring>
+#include "double_change.h"
+#include "gaussian_finder.h"
+#include "linear_model.h"
+#include "numerical_discrepancy.h"
+
+using namespace std;
+
+static const char *detector_names[NUM_SCREENED_DETECTORS] = {
+	"double_change",
+	"linear_model",
+	"gaussians",
+	"numerical_discrepancy",
+};
+
+series_screen::series_screen(const screening_thresholds &thresholds)
+	: thresholds(thresholds), stats(), series(NULL)
+{
+	memset(num_screened, 0, sizeof(num_screened));
+	memset(num_skipped, 0, sizeof(num_skipped));
+}
+
+void series_screen::set_thresholds(const screening_thresholds &thresholds)
+{
+	this->thresholds = thresholds;
+}
+
+void series_screen::screen(const double *series, size_t inf, size_t sup)
+{
+	compute_series_statistics(series, inf, sup, &stats);
+	this->series = series;
+}
+
+/*
+ * The series is standardized in place before the later detectors, whether
+ * the linear model ran or was screened out.
+ */
+void series_screen::series_normalized()
+{
+	normalize_series_statistics(&stats);
+}
+
+bool series_screen::admits(screened_detector detector)
+{
+	bool admissible = true;
+
+	switch (detector) {
+	case SCREEN_DOUBLE_CHANGE:
+		admissible = double_change_admissible(series, &stats);
+		break;
+	case SCREEN_LINEAR_MODEL:
+		admissible = linear_model_admissible(&stats,
+			thresholds.min_linear_model_burstiness) != 0;
+		break;
+	case SCREEN_GAUSSIANS:
+		admissible = gaussians_admissible(stats, thresholds.min_gaussian_burstiness);
+		break;
+	case SCREEN_DISCREPANCY:
+		admissible = discrepancy_admissible(stats);
+		break;
+	default:
+		break;
+	}
+
+	num_screened[detector]++;
+	if (!admissible)
+		num_skipped[detector]++;
+	return admissible;
+}
+
+const series_statistics & series_screen::statistics() const
+{
+	return stats;
+}
+
+void series_screen::print_counters(FILE *f) const
+{
+	for (int i = 0; i < NUM_SCREENED_DETECTORS; i++) {
+		if (num_screened[i] == 0)
+			continue;
+		fprintf(f, "%s: skipped %llu of %llu (%.2f%%)\n", detector_names[i],
+			num_skipped[i], num_screened[i],
+			100.0 * (double) num_skipped[i] / (double) num_screened[i]);
+	}
+}
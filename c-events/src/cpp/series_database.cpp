@@ -0,0 +1,155 @@
+#include "series_database.h"
+#include <algorithm>
+#include <cstring>
+#include "series.h"
+
+using namespace std;
+
+series_database::series_database(size_t cache_size)
+	: cache_size(max(cache_size, (size_t) 1)), opened(false)
+{
+}
+
+series_database::~series_database()
+{
+	if (opened)
+		destroy_mapped_dictionary(&dictionary);
+	for (size_t i = 0; i < matrices.size(); i++)
+		unmap_file(&matrices[i].file);
+}
+
+int series_database::open(const char *base_filename, const char *total_counts_filename)
+{
+	if (init_mapped_dictionary(&dictionary, base_filename, total_counts_filename) != 0)
+		return 1;
+	opened = true;
+	return 0;
+}
+
+/* Whether count entries of size bytes at offset lie within the file */
+static bool within_file(const mapped_file &file, uint64_t offset, uint64_t count, size_t size)
+{
+	return offset <= file.size && offset % size == 0 && count <= (file.size - offset) / size;
+}
+
+/*
+ * Checks the header against the size of the file, and the row pointers of a
+ * CSR matrix, which relevance_row follows without checking.
+ */
+static bool valid_relevance(const relevance_view &view)
+{
+	const struct relevance_matrix_header *header = view.header;
+
+	if (view.file.size < sizeof(*header) ||
+			memcmp(header->magic, RELEVANCE_MATRIX_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != RELEVANCE_MATRIX_VERSION)
+		return false;
+
+	if (header->format == RELEVANCE_DENSE)
+		return header->num_cols == 0 ? header->data_offset <= view.file.size :
+			within_file(view.file, header->data_offset, header->num_rows, header->num_cols);
+	if (header->format != RELEVANCE_CSR ||
+			!within_file(view.file, header->indices_offset, header->nnz, sizeof(int32_t)) ||
+			!within_file(view.file, header->data_offset, header->nnz, sizeof(uint8_t)) ||
+			header->num_rows >= view.file.size ||
+			!within_file(view.file, header->indptr_offset, header->num_rows + 1, sizeof(int64_t)))
+		return false;
+
+	const int64_t *indptr = (const int64_t *) ((const char *) view.file.data +
+		header->indptr_offset);
+	if (indptr[0] != 0 || (uint64_t) indptr[header->num_rows] != header->nnz)
+		return false;
+	for (uint64_t i = 0; i < header->num_rows; i++)
+		if (indptr[i] > indptr[i + 1])
+			return false;
+	return true;
+}
+
+/* Maps a matrix written by relevance in the CSR or dense format */
+int series_database::add_relevance(const char *name, const char *filename)
+{
+	relevance_view view;
+
+	view.name = name;
+	if (map_file(&view.file, filename) != 0)
+		return 1;
+
+	view.header = (const struct relevance_matrix_header *) view.file.data;
+	if (!valid_relevance(view)) {
+		fprintf(stderr, "Ignoring the invalid relevance matrix: %s\n", filename);
+		unmap_file(&view.file);
+		return 1;
+	}
+
+	const char *base = (const char *) view.file.data;
+	view.indices = (const int32_t *) (base + view.header->indices_offset);
+	view.data = (const uint8_t *) (base + view.header->data_offset);
+	view.indptr = (const int64_t *) (base + view.header->indptr_offset);
+	matrices.push_back(view);
+	return 0;
+}
+
+size_t series_database::num_words() const
+{
+	return opened ? dictionary.num_words : 0;
+}
+
+long series_database::find_word(const char *word, size_t length) const
+{
+	return opened ? find_mapped_word(&dictionary, word, length) : -1;
+}
+
+/* The frequencies of mapped_word_frequencies, from the cache when possible */
+const vector<double> & series_database::frequencies(size_t index)
+{
+	map<size_t, cache_list::iterator>::iterator it = cached.find(index);
+	if (it != cached.end()) {
+		cache.splice(cache.begin(), cache, it->second);
+		return it->second->second;
+	}
+
+	if (cache.size() >= cache_size) {
+		cached.erase(cache.back().first);
+		cache.pop_back();
+	}
+	cache.push_front(make_pair(index, vector<double>(MAX_YEARS)));
+	cached[index] = cache.begin();
+
+	vector<double> &series = cache.front().second;
+	mapped_word_frequencies(&dictionary, index, &series[0]);
+	return series;
+}
+
+void series_database::smoothed_frequencies(size_t index, unsigned int smoothing_window,
+	vector<double> &series)
+{
+	const vector<double> &in = frequencies(index);
+
+	series.resize(MAX_YEARS);
+	average_series(&in[0], &series[0], MAX_YEARS, smoothing_window);
+}
+
+/* The row of the word in the named matrix, zero beyond its last row */
+bool series_database::relevance_row(const string &name, size_t index, vector<int> &row) const
+{
+	for (size_t m = 0; m < matrices.size(); m++) {
+		const relevance_view &view = matrices[m];
+		if (view.name != name)
+			continue;
+
+		row.assign(MAX_YEARS, 0);
+		if (index >= view.header->num_rows)
+			return true;
+		if (view.header->format == RELEVANCE_DENSE) {
+			const uint8_t *values = view.data + index * view.header->num_cols;
+			for (size_t j = 0; j < view.header->num_cols && j < MAX_YEARS; j++)
+				row[j] = values[j];
+		} else {
+			for (int64_t k = view.indptr[index]; k < view.indptr[index + 1]; k++)
+				if (view.indices[k] >= 0 && view.indices[k] < MAX_YEARS)
+					row[(size_t) view.indices[k]] = view.data[k];
+		}
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "series_database.h"
+
+#define CACHE_SIZE 100000
+#define WEBSITE_MIN_YEAR 1500
+#define WEBSITE_MAX_YEAR 2008
+/* Wider windows than the series would only average all of it */
+#define MAX_SMOOTHING (MAX_YEARS - 1)
+
+using namespace std;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+	running = 0;
+}
+
+/* Maps every binary matrix of the directory, named after its file */
+static void add_relevance_directory(series_database &db, const char *directory)
+{
+	DIR *dir = opendir(directory);
+	struct dirent *entry;
+
+	if (dir == NULL)
+		return;
+	while ((entry = readdir(dir)) != NULL) {
+		const string filename = entry->d_name;
+		const size_t dot = filename.rfind('.');
+		if (dot == string::npos)
+			continue;
+		const string extension = filename.substr(dot);
+		if (extension != ".csr" && extension != ".u8")
+			continue;
+		if (db.add_relevance(filename.substr(0, dot).c_str(),
+				(string(directory) + "/" + filename).c_str()) == 0)
+			printf("Mapped %s/%s\n", directory, filename.c_str());
+	}
+	closedir(dir);
+}
+
+static void split(const string &s, char separator, vector<string> &fields)
+{
+	size_t start = 0, end;
+
+	fields.clear();
+	while ((end = s.find(separator, start)) != string::npos) {
+		fields.push_back(s.substr(start, end - start));
+		start = end + 1;
+	}
+	fields.push_back(s.substr(start));
+}
+
+static void append_json_string(string &out, const string &s)
+{
+	char escaped[8];
+
+	out += '"';
+	for (size_t i = 0; i < s.size(); i++) {
+		const unsigned char c = (unsigned char) s[i];
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += (char) c;
+		} else if (c < 0x20) {
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out += escaped;
+		} else {
+			out += (char) c;
+		}
+	}
+	out += '"';
+}
+
+template<class T>
+static void append_json_array(string &out, const vector<T> &values, size_t first, size_t last,
+	const char *format)
+{
+	char number[32];
+
+	out += '[';
+	for (size_t i = first; i <= last; i++) {
+		snprintf(number, sizeof(number), format, values[i]);
+		if (i > first)
+			out += ',';
+		out += number;
+	}
+	out += ']';
+}
+
+static int clamp_year(int year)
+{
+	return max(WEBSITE_MIN_YEAR, min(year, WEBSITE_MAX_YEAR));
+}
+
+/*
+ * Answers one request line, made of tab-separated fields: the smoothing
+ * window, the first and last years, the comma-separated relevance matrices
+ * and then the words. The answer is a single line of JSON with the series
+ * and the relevance rows of every word over the years, clamped as the
+ * website does. Unknown words get zeros, and smoothing windows which are
+ * not a number from 0 to MAX_SMOOTHING an error.
+ */
+static void answer(series_database &db, const string &request, string &out)
+{
+	vector<string> fields, models;
+	vector<double> series;
+	vector<int> row;
+	char number[64];
+
+	split(request, '\t', fields);
+	if (fields.size() < 4) {
+		out = "{\"error\":\"expected smoothing, year_start, year_end, models and words\"}\n";
+		return;
+	}
+
+	char *end;
+	errno = 0;
+	const unsigned long smoothing = strtoul(fields[0].c_str(), &end, 10);
+	if (fields[0].empty() || *end != '\0' || errno != 0 || fields[0][0] == '-' ||
+			smoothing > MAX_SMOOTHING) {
+		snprintf(number, sizeof(number), "{\"error\":\"expected a smoothing from 0 to %d\"}\n",
+			MAX_SMOOTHING);
+		out = number;
+		return;
+	}
+	const int year_start = clamp_year(atoi(fields[1].c_str()));
+	const int year_end = max(year_start, clamp_year(atoi(fields[2].c_str())));
+	const size_t first = (size_t) (year_start - MIN_YEAR), last = (size_t) (year_end - MIN_YEAR);
+	if (!fields[3].empty())
+		split(fields[3], ',', models);
+
+	snprintf(number, sizeof(number), "{\"year_start\":%d,\"year_end\":%d,\"words\":[",
+		year_start, year_end);
+	out = number;
+	for (size_t i = 4; i < fields.size(); i++) {
+		const string &word = fields[i];
+		const long index = db.find_word(word.data(), word.size());
+
+		if (i > 4)
+			out += ',';
+		out += "{\"word\":";
+		append_json_string(out, word);
+		snprintf(number, sizeof(number), ",\"index\":%ld,\"series\":", index);
+		out += number;
+		if (index >= 0)
+			db.smoothed_frequencies((size_t) index, (unsigned int) smoothing, series);
+		else
+			series.assign(MAX_YEARS, 0.0);
+		append_json_array(out, series, first, last, "%.17g");
+
+		out += ",\"relevance\":{";
+		bool first_model = true;
+		for (size_t m = 0; m < models.size(); m++) {
+			/* Unknown words are past the last row of every matrix */
+			if (!db.relevance_row(models[m], index >= 0 ? (size_t) index : (size_t) -1, row))
+				continue;
+			if (!first_model)
+				out += ',';
+			first_model = false;
+			append_json_string(out, models[m]);
+			out += ':';
+			append_json_array(out, row, first, last, "%d");
+		}
+		out += "}}";
+	}
+	out += "]}\n";
+}
+
+/* Answers request lines until the client hangs up */
+static void serve(series_database &db, int fd)
+{
+	FILE *in, *out_file;
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t length;
+	string out;
+
+	in = fdopen(fd, "r");
+	if (in == NULL) {
+		close(fd);
+		return;
+	}
+	out_file = fdopen(dup(fd), "w");
+	if (out_file == NULL) {
+		fclose(in);
+		return;
+	}
+
+	while (running && (length = getline(&line, &capacity, in)) > 0) {
+		string request(line, (size_t) length);
+		while (!request.empty() && (request[request.size() - 1] == '\n' ||
+				request[request.size() - 1] == '\r'))
+			request.erase(request.size() - 1);
+		answer(db, request, out);
+		if (fwrite(out.data(), 1, out.size(), out_file) != out.size() || fflush(out_file) != 0)
+			break;
+	}
+
+	free(line);
+	fclose(out_file);
+	fclose(in);
+}
+
+/*
+ * Usage: series_server [socket]
+ * Maps the sorted dictionary and the binary relevance matrices once, then
+ * answers the website's queries on a Unix socket, data/series.sock by default.
+ */
+int main(int argc, char **argv)
+{
+	const char *socket_path = argc > 1 ? argv[1] : "data/series.sock";
+	series_database db(CACHE_SIZE);
+	struct sockaddr_un address;
+	struct sigaction action;
+	int server;
+
+	if (db.open("data/sort/googlebooks-eng-all-1gram-20120701-database",
+			"data/googlebooks-eng-all-totalcounts-20120701.txt") != 0) {
+		fprintf(stderr, "Could not map the dictionary\n");
+		return 1;
+	}
+	printf("Mapped %lu words\n", (unsigned long) db.num_words());
+	add_relevance_directory(db, "data/relevance");
+
+	if (strlen(socket_path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", socket_path);
+		return 1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socket_path);
+
+	server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0) {
+		perror("socket");
+		return 1;
+	}
+	unlink(socket_path);
+	if (bind(server, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+			listen(server, 16) != 0) {
+		perror(socket_path);
+		close(server);
+		return 1;
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("Listening on %s\n", socket_path);
+	while (running) {
+		int client = accept(server, NULL, NULL);
+		if (client < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("accept");
+			break;
+		}
+		serve(db, client);
+	}
+
+	close(server);
+	unlink(socket_path);
+	return 0;
+}
@@ -0,0 +1,286 @@
+#include "sparse_relevance.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <gsl/gsl_cblas.h>
+#include "relevance_matrix.h"
+#include "util.h"
+
+#define READ_BUFFER_SIZE (1 << 16)
+
+using namespace std;
+
+static void append_row(sparse_relevance &matrix)
+{
+	matrix.num_rows++;
+	matrix.indptr.push_back(matrix.indices.size());
+}
+
+/* Parses the rows of integers of a relevance CSV, keeping the nonzeros. */
+static int read_csv(FILE *f, sparse_relevance &matrix)
+{
+	char buffer[READ_BUFFER_SIZE];
+	size_t num_read;
+	uint32_t column = 0;
+	long value = 0;
+	bool negative = false, in_row = false;
+
+	while ((num_read = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+		for (size_t i = 0; i < num_read; i++) {
+			const char c = buffer[i];
+			if (c >= '0' && c <= '9') {
+				value = 10 * value + (c - '0');
+				in_row = true;
+			} else if (c == '-') {
+				negative = true;
+			} else if (c == ',' || c == '\n') {
+				if (value != 0) {
+					matrix.indices.push_back(column);
+					matrix.values.push_back((float) (negative ? -value : value));
+				}
+				column++;
+				if (column > matrix.num_cols)
+					matrix.num_cols = column;
+				value = 0;
+				negative = false;
+				if (c == '\n') {
+					append_row(matrix);
+					column = 0;
+					in_row = false;
+				}
+			}
+		}
+	}
+	if (in_row) {
+		if (value != 0) {
+			matrix.indices.push_back(column);
+			matrix.values.push_back((float) (negative ? -value : value));
+		}
+		if (column + 1 > matrix.num_cols)
+			matrix.num_cols = column + 1;
+		append_row(matrix);
+	}
+
+	return ferror(f) ? -1 : 0;
+}
+
+static int read_csr(FILE *f, const relevance_matrix_header &header,
+	sparse_relevance &matrix)
+{
+	vector<int32_t> indices(header.nnz);
+	vector<uint8_t> data(header.nnz);
+	vector<int64_t> indptr(header.num_rows + 1);
+
+	/* A matrix without nonzeros has no indices nor data to read */
+	if (header.nnz > 0) {
+		if (fseek64(f, (long long) header.indices_offset, SEEK_SET) != 0 ||
+				fread(&indices[0], sizeof(int32_t), indices.size(), f) != indices.size())
+			return -1;
+		if (fseek64(f, (long long) header.data_offset, SEEK_SET) != 0 ||
+				fread(&data[0], 1, data.size(), f) != data.size())
+			return -1;
+	}
+	if (fseek64(f, (long long) header.indptr_offset, SEEK_SET) != 0 ||
+			fread(&indptr[0], sizeof(int64_t), indptr.size(), f) != indptr.size())
+		return -1;
+
+	/* The rows and years are followed without checks later on */
+	if (indptr[0] != 0 || (uint64_t) indptr.back() != header.nnz)
+		return -1;
+	for (size_t i = 0; i + 1 < indptr.size(); i++)
+		if (indptr[i] > indptr[i + 1])
+			return -1;
+	for (size_t k = 0; k < indices.size(); k++)
+		if (indices[k] < 0 || (uint64_t) indices[k] >= header.num_cols)
+			return -1;
+
+	matrix.num_rows = header.num_rows;
+	matrix.indptr.assign(indptr.begin(), indptr.end());
+	matrix.indices.assign(indices.begin(), indices.end());
+	matrix.values.assign(data.begin(), data.end());
+	return 0;
+}
+
+static int read_dense(FILE *f, const relevance_matrix_header &header,
+	sparse_relevance &matrix)
+{
+	vector<uint8_t> row(header.num_cols);
+
+	if (fseek64(f, (long long) header.data_offset, SEEK_SET) != 0)
+		return -1;
+	for (uint64_t i = 0; i < header.num_rows; i++) {
+		if (!row.empty() && fread(&row[0], 1, row.size(), f) != row.size())
+			return -1;
+		for (size_t j = 0; j < row.size(); j++) {
+			if (row[j] != 0) {
+				matrix.indices.push_back((uint32_t) j);
+				matrix.values.push_back(row[j]);
+			}
+		}
+		append_row(matrix);
+	}
+	return 0;
+}
+
+/*
+ * Reads a relevance matrix written by relevance, either binary (CSR or dense)
+ * or as CSV, into memory proportional to its nonzeros.
+ */
+int read_sparse_relevance(const char *filename, sparse_relevance &matrix)
+{
+	relevance_matrix_header header;
+	FILE *f;
+	int err;
+
+	matrix.num_rows = 0;
+	matrix.num_cols = 0;
+	matrix.indptr.assign(1, 0);
+	matrix.indices.clear();
+	matrix.values.clear();
+
+	f = fopen(filename, "rb");
+	if (f == NULL)
+		return -1;
+
+	if (fread(&header, sizeof(header), 1, f) == 1 &&
+			memcmp(header.magic, RELEVANCE_MATRIX_MAGIC, sizeof(header.magic)) == 0) {
+		matrix.num_cols = header.num_cols;
+		if (header.format == RELEVANCE_CSR)
+			err = read_csr(f, header, matrix);
+		else if (header.format == RELEVANCE_DENSE)
+			err = read_dense(f, header, matrix);
+		else
+			err = -1;
+	} else {
+		rewind(f);
+		err = read_csv(f, matrix);
+	}
+
+	fclose(f);
+	return err;
+}
+
+/*
+ * Transposes the matrix into one vector per year, over the words, scaled to
+ * unit length. Words stay in increasing order within each year.
+ */
+void relevance_to_year_vectors(const sparse_relevance &matrix,
+	vector<sparse_vector> &years)
+{
+	vector<size_t> counts(matrix.num_cols, 0);
+	vector<float> lengths;
+
+	for (size_t k = 0; k < matrix.indices.size(); k++)
+		counts[matrix.indices[k]]++;
+	year_lengths(matrix, lengths);
+
+	years.assign(matrix.num_cols, sparse_vector());
+	for (size_t i = 0; i < matrix.num_cols; i++) {
+		years[i].indices.reserve(counts[i]);
+		years[i].values.reserve(counts[i]);
+	}
+
+	for (size_t row = 0; row < matrix.num_rows; row++) {
+		for (uint64_t k = matrix.indptr[row]; k < matrix.indptr[row + 1]; k++) {
+			const uint32_t year = matrix.indices[k];
+			years[year].indices.push_back((uint32_t) row);
+			years[year].values.push_back(matrix.values[k] / lengths[year]);
+		}
+	}
+}
+
+float sparse_dot(const sparse_vector &x, const sparse_vector &y)
+{
+	float sum = 0.0f;
+	size_t i = 0, j = 0;
+
+	while (i < x.indices.size() && j < y.indices.size()) {
+		if (x.indices[i] < y.indices[j]) {
+			i++;
+		} else if (x.indices[i] > y.indices[j]) {
+			j++;
+		} else {
+			sum += x.values[i] * y.values[j];
+			i++;
+			j++;
+		}
+	}
+	return sum;
+}
+
+/* The euclidean length of every year over the words, zero for empty years */
+void year_lengths(const sparse_relevance &matrix, vector<float> &lengths)
+{
+	vector<double> sums(matrix.num_cols, 0.0);
+
+	for (size_t k = 0; k < matrix.indices.size(); k++)
+		sums[matrix.indices[k]] += (double) matrix.values[k] * matrix.values[k];
+
+	lengths.resize(matrix.num_cols);
+	for (size_t i = 0; i < matrix.num_cols; i++)
+		lengths[i] = (float) sqrt(sums[i]);
+}
+
+/*
+ * Cosine similarities of all the pairs of years, as the upper triangle of a
+ * row-major num_cols x num_cols matrix. Every word adds the products of its
+ * own nonzero years, so the work is the sum of the squared row lengths and
+ * each entry is accumulated in increasing word order, exactly as a dot
+ * product of the year vectors would.
+ */
+void year_gram_matrix(const sparse_relevance &matrix, vector<float> &gram)
+{
+	const size_t n = matrix.num_cols;
+	vector<float> lengths;
+	vector<uint32_t> years;
+	vector<float> values;
+
+	year_lengths(matrix, lengths);
+	gram.assign(n * n, 0.0f);
+
+	for (size_t row = 0; row < matrix.num_rows; row++) {
+		years.clear();
+		values.clear();
+		for (uint64_t k = matrix.indptr[row]; k < matrix.indptr[row + 1]; k++) {
+			years.push_back(matrix.indices[k]);
+			values.push_back(matrix.values[k] / lengths[matrix.indices[k]]);
+		}
+		for (size_t i = 0; i < years.size(); i++) {
+			float *gram_row = &gram[years[i] * n];
+			const float value = values[i];
+			gram_row[years[i]] += value * value;
+			for (size_t j = i + 1; j < years.size(); j++)
+				gram_row[years[j]] += value * values[j];
+		}
+	}
+}
+
+/*
+ * Same as year_gram_matrix, through symmetric rank-k updates of BLAS over
+ * dense blocks of block_size words. Worth it when the rows are dense; the
+ * sums are taken in another order, so the results may differ in the last
+ * bits.
+ */
+void year_gram_matrix_blocked(const sparse_relevance &matrix, vector<float> &gram,
+	size_t block_size)
+{
+	const size_t n = matrix.num_cols;
+	vector<float> lengths;
+	vector<float> block(n * block_size);
+
+	year_lengths(matrix, lengths);
+	gram.assign(n * n, 0.0f);
+
+	for (size_t first = 0; first < matrix.num_rows; first += block_size) {
+		const size_t last = min(first + block_size, matrix.num_rows);
+		fill(block.begin(), block.end(), 0.0f);
+		for (size_t row = first; row < last; row++) {
+			for (uint64_t k = matrix.indptr[row]; k < matrix.indptr[row + 1]; k++) {
+				const uint32_t year = matrix.indices[k];
+				block[year * block_size + (row - first)] = matrix.values[k] / lengths[year];
+			}
+		}
+		cblas_ssyrk(CblasRowMajor, CblasUpper, CblasNoTrans, (int) n, (int) (last - first),
+			1.0f, &block[0], (int) block_size, 1.0f, &gram[0], (int) n);
+	}
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include "stage_metrics.h"
+
+using namespace std;
+
+#ifndef NO_STAGE_METRICS
+
+static const char *stage_names[] = {
+	"read_table",
+	"series",
+	"screening",
+	"double_change",
+	"linear_model",
+	"gaussians",
+	"discrepancy",
+	"kleinberg",
+};
+
+static double elapsed_seconds(const struct timespec &start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double) (now.tv_sec - start.tv_sec) + 1e-9 * (double) (now.tv_nsec - start.tv_nsec);
+}
+
+/* Bucket b holds the times of [2^b, 2^(b+1)) ticks */
+static size_t latency_bucket(uint64_t ticks)
+{
+	size_t bucket = 0;
+
+	while (ticks > 1 && bucket < NUM_LATENCY_BUCKETS - 1) {
+		ticks >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+/* The upper bound of the bucket which reaches the fraction of the counts, in ticks */
+static double histogram_percentile(const unsigned long long *histogram, double fraction)
+{
+	unsigned long long total = 0, cumulative = 0;
+
+	for (size_t b = 0; b < NUM_LATENCY_BUCKETS; b++)
+		total += histogram[b];
+	for (size_t b = 0; b < NUM_LATENCY_BUCKETS; b++) {
+		cumulative += histogram[b];
+		if (total > 0 && (double) cumulative >= fraction * (double) total)
+			return (double) (2ULL << b);
+	}
+	return 0.0;
+}
+
+static void format_duration(double seconds, char *s, size_t size)
+{
+	const unsigned long total = (unsigned long) (seconds + 0.5);
+
+	snprintf(s, size, "%lu:%02lu:%02lu", total / 3600, total / 60 % 60, total % 60);
+}
+
+stage_metrics::stage_metrics(size_t num_slowest)
+	: num_slowest(num_slowest)
+{
+	start(0);
+}
+
+/* Starts a pass over num_words positions, forgetting the previous one */
+void stage_metrics::start(size_t num_words)
+{
+	this->num_words = num_words;
+	percent = 0;
+	num_timed = 0;
+	word_start = 0;
+	last_mark = 0;
+	memset(word_ticks, 0, sizeof(word_ticks));
+	memset(stage_ticks, 0, sizeof(stage_ticks));
+	memset(stage_histograms, 0, sizeof(stage_histograms));
+	memset(word_histogram, 0, sizeof(word_histogram));
+	slowest.clear();
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	start_ticks = read_ticks();
+}
+
+void stage_metrics::end_word(const char *word)
+{
+	const uint64_t ticks = last_mark - word_start;
+
+	num_timed++;
+	for (size_t i = 0; i < NUM_PIPELINE_STAGES; i++) {
+		if (word_ticks[i] == 0)
+			continue;
+		stage_ticks[i] += word_ticks[i];
+		stage_histograms[i][latency_bucket(word_ticks[i])]++;
+	}
+	word_histogram[latency_bucket(ticks)]++;
+
+	/* The slowest words are kept in a heap whose top is the fastest of them */
+	if (num_slowest == 0 || (slowest.size() == num_slowest && ticks <= slowest.front().ticks))
+		return;
+	if (slowest.size() == num_slowest) {
+		pop_heap(slowest.begin(), slowest.end(), greater<slow_word>());
+		slowest.pop_back();
+	}
+	slowest.push_back(slow_word());
+	slow_word &entry = slowest.back();
+	entry.ticks = ticks;
+	entry.word = word;
+	memcpy(entry.stage_ticks, word_ticks, sizeof(word_ticks));
+	push_heap(slowest.begin(), slowest.end(), greater<slow_word>());
+}
+
+/*
+ * Prints how far the pass is every 4%, with the positions per second so
+ * far and the time left at that pace.
+ */
+void stage_metrics::progress(size_t position)
+{
+	const size_t new_percent = (100 * position) / num_words;
+	char eta[32];
+
+	if (new_percent <= percent)
+		return;
+	percent = new_percent;
+	if (percent % 4 != 0)
+		return;
+
+	const double seconds = elapsed_seconds(start_time);
+	const double rate = (double) position / seconds;
+	format_duration((double) (num_words - position) / rate, eta, sizeof(eta));
+	printf("%u%% done, %.0f words/s, %llu timed, ETA %s\n", (unsigned int) percent, rate,
+		num_timed, eta);
+}
+
+/* The time stamp counter is calibrated against the clock over the whole pass */
+double stage_metrics::seconds_per_tick() const
+{
+	const uint64_t ticks = read_ticks() - start_ticks;
+
+	return ticks > 0 ? elapsed_seconds(start_time) / (double) ticks : 0.0;
+}
+
+void stage_metrics::print(FILE *f) const
+{
+	const double tick_us = 1e6 * seconds_per_tick();
+	vector<slow_word> sorted(slowest);
+	uint64_t total_ticks = 0;
+
+	for (size_t i = 0; i < NUM_PIPELINE_STAGES; i++)
+		total_ticks += stage_ticks[i];
+
+	fprintf(f, "Timed %llu words in %.2f s\n", num_timed, tick_us * (double) total_ticks / 1e6);
+	fprintf(f, "%-14s %10s %7s %12s %12s %12s\n", "stage", "seconds", "share", "mean us/word",
+		"p50 us <=", "p99 us <=");
+	for (size_t i = 0; i < NUM_PIPELINE_STAGES; i++) {
+		unsigned long long num_words_timed = 0;
+		for (size_t b = 0; b < NUM_LATENCY_BUCKETS; b++)
+			num_words_timed += stage_histograms[i][b];
+		fprintf(f, "%-14s %10.3f %6.1f%% %12.2f %12.2f %12.2f\n", stage_names[i],
+			tick_us * (double) stage_ticks[i] / 1e6,
+			total_ticks > 0 ? 100.0 * (double) stage_ticks[i] / (double) total_ticks : 0.0,
+			num_words_timed > 0 ? tick_us * (double) stage_ticks[i] / (double) num_words_timed : 0.0,
+			tick_us * histogram_percentile(stage_histograms[i], 0.5),
+			tick_us * histogram_percentile(stage_histograms[i], 0.99));
+	}
+
+	fprintf(f, "Time per word:\n");
+	for (size_t b = 0; b < NUM_LATENCY_BUCKETS; b++)
+		if (word_histogram[b] > 0)
+			fprintf(f, "  < %12.2f us %12llu\n", tick_us * (double) (2ULL << b), word_histogram[b]);
+
+	sort(sorted.begin(), sorted.end(), greater<slow_word>());
+	if (!sorted.empty())
+		fprintf(f, "Slowest words:\n");
+	for (size_t i = 0; i < sorted.size(); i++) {
+		fprintf(f, "  %-24s %10.1f us:", sorted[i].word.c_str(), tick_us * (double) sorted[i].ticks);
+		for (size_t j = 0; j < NUM_PIPELINE_STAGES; j++)
+			if (sorted[i].stage_ticks[j] > 0)
+				fprintf(f, " %s=%.1f", stage_names[j], tick_us * (double) sorted[i].stage_ticks[j]);
+		fprintf(f, "\n");
+	}
+}
+
+#endif /* NO_STAGE_METRICS */
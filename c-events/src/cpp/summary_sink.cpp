@@ -0,0 +1,195 @@
+#include "summary_sink.h"
+#include <cstring>
+
+using namespace std;
+
+static const char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/* Writes the decimal digits of value at p and returns the end of them. */
+static char * format_unsigned(char *p, unsigned long value)
+{
+	char digits[24];
+	char *q = digits + sizeof(digits);
+
+	while (value >= 100) {
+		const char *pair = &digit_pairs[2 * (value % 100)];
+		value /= 100;
+		*--q = pair[1];
+		*--q = pair[0];
+	}
+	if (value >= 10) {
+		const char *pair = &digit_pairs[2 * value];
+		*--q = pair[1];
+		*--q = pair[0];
+	} else {
+		*--q = (char) ('0' + value);
+	}
+
+	size_t length = (size_t) (digits + sizeof(digits) - q);
+	memcpy(p, q, length);
+	return p + length;
+}
+
+static char * format_int(char *p, int value)
+{
+	if (value < 0) {
+		*p++ = '-';
+		return format_unsigned(p, 0UL - (unsigned long) value);
+	}
+	return format_unsigned(p, (unsigned long) value);
+}
+
+summary_sink::summary_sink()
+	: f(NULL), word_file(NULL), index(NULL), used(0), word(NULL), word_length(0),
+	word_written(false), next_word_id(0), started(false), failed(false)
+#ifdef HAVE_ZSTD
+	, cctx(NULL)
+#endif
+{ }
+
+summary_sink::~summary_sink()
+{
+	close();
+}
+
+int summary_sink::open(FILE *f, FILE *word_file, bool compressed)
+{
+	close();
+#ifdef HAVE_ZSTD
+	if (compressed) {
+		cctx = ZSTD_createCCtx();
+		if (cctx == NULL)
+			return -1;
+		compressed_buffer.resize(ZSTD_CStreamOutSize());
+	}
+#else
+	if (compressed)
+		return -1;
+#endif
+	this->f = f;
+	this->word_file = word_file;
+	buffer.resize(SUMMARY_BUFFER_SIZE);
+	used = 0;
+	next_word_id = 0;
+	started = false;
+	failed = false;
+	return 0;
+}
+
+bool summary_sink::is_open() const
+{
+	return f != NULL;
+}
+
+void summary_sink::attach_index(event_index *index)
+{
+	this->index = index;
+}
+
+void summary_sink::begin_word(const char *word)
+{
+	if (index != NULL)
+		index->begin_word(word);
+	this->word = word;
+	word_length = strlen(word);
+	word_written = false;
+}
+
+void summary_sink::reserve(size_t size)
+{
+	if (used + size <= buffer.size())
+		return;
+	flush(false);
+	if (size > buffer.size())
+		buffer.resize(size);
+}
+
+void summary_sink::append(unsigned int year, int score)
+{
+	if (index != NULL)
+		index->add(year, score);
+	if (f == NULL)
+		return;
+
+	if (word_file != NULL && !word_written) {
+		*format_unsigned(word_id, next_word_id) = 0;
+		if (fprintf(word_file, "%s\t%s\n", word_id, word) < 0)
+			failed = true;
+		next_word_id++;
+		word = word_id;
+		word_length = strlen(word_id);
+	}
+	word_written = true;
+	started = true;
+
+	reserve(word_length + 32);
+	char *p = &buffer[used];
+	memcpy(p, word, word_length);
+	p += word_length;
+	*p++ = '\t';
+	p = format_unsigned(p, year);
+	*p++ = '\t';
+	p = format_int(p, score);
+	*p++ = '\n';
+	used = (size_t) (p - &buffer[0]);
+}
+
+void summary_sink::flush(bool end)
+{
+#ifdef HAVE_ZSTD
+	if (cctx != NULL) {
+		ZSTD_inBuffer input = { &buffer[0], used, 0 };
+		const ZSTD_EndDirective mode = end ? ZSTD_e_end : ZSTD_e_continue;
+		bool finished;
+		do {
+			ZSTD_outBuffer output = { &compressed_buffer[0], compressed_buffer.size(), 0 };
+			size_t remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+			if (ZSTD_isError(remaining)) {
+				failed = true;
+				break;
+			}
+			if (fwrite(output.dst, 1, output.pos, f) != output.pos)
+				failed = true;
+			finished = end ? remaining == 0 : input.pos == input.size;
+		} while (!finished);
+		used = 0;
+		return;
+	}
+#endif
+	(void) end;
+	if (used > 0 && fwrite(&buffer[0], 1, used, f) != used)
+		failed = true;
+	used = 0;
+}
+
+/*
+ * Flushes the buffer and ends the compressed stream, if anything was written.
+ * The files stay open and belong to the caller.
+ */
+int summary_sink::close()
+{
+	if (f == NULL)
+		return 0;
+
+	if (started)
+		flush(true);
+	if (fflush(f) != 0)
+		failed = true;
+#ifdef HAVE_ZSTD
+	ZSTD_freeCCtx(cctx);
+	cctx = NULL;
+#endif
+	f = NULL;
+	word_file = NULL;
+	return failed ? -1 : 0;
+}
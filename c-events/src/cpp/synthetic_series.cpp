@@ -0,0 +1,115 @@
+#include "synthetic_series.h"
+#include <cmath>
+
+static unsigned long long rng_state = 88172645463325252ULL;
+
+void seed_synthetic(unsigned int seed)
+{
+	rng_state = 88172645463325252ULL ^ ((unsigned long long) seed << 1);
+	if (rng_state == 0)
+		rng_state = 1;
+}
+
+/* xorshift64*, so that the generated families do not depend on the libc rand(). */
+double uniform_sample()
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	unsigned long long x = rng_state * 2685821657736338717ULL;
+	return ((double) (x >> 11) + 0.5) / 9007199254740992.0;
+}
+
+double pareto_sample(double scale, double shape)
+{
+	return scale / pow(uniform_sample(), 1.0 / shape);
+}
+
+/*
+ * A noisy baseline with Pareto-distributed bursts: most years stay close to
+ * the baseline, a few are orders of magnitude above it, which is the worst
+ * case for the candidate list of the maximal subsequences.
+ */
+void heavy_tailed_series(double *series, size_t size, double shape)
+{
+	double baseline = pareto_sample(1e-6, 2.0);
+
+	for (size_t i = 0; i < size; i++) {
+		double value = baseline * (0.5 + uniform_sample());
+		if (uniform_sample() < 0.1)
+			value += baseline * pareto_sample(1.0, shape);
+		series[i] = value;
+	}
+}
+
+/* A constant level with a few percent of noise, which no detector should flag */
+void flat_series(double *series, size_t size, double level)
+{
+	for (size_t i = 0; i < size; i++)
+		series[i] = level * (0.98 + 0.04 * uniform_sample());
+}
+
+/* A flat series where a single year is ten to a hundred times above the level */
+void spike_series(double *series, size_t size, double level)
+{
+	flat_series(series, size, level);
+	series[(size_t) (uniform_sample() * (double) size)] *= 10.0 + 90.0 * uniform_sample();
+}
+
+static void add_bump(double *series, size_t size, double height)
+{
+	const double center = uniform_sample() * (double) size;
+	const double sigma = 2.0 + 18.0 * uniform_sample();
+
+	for (size_t i = 0; i < size; i++) {
+		const double z = ((double) i - center) / sigma;
+		series[i] += height * exp(-0.5 * z * z);
+	}
+}
+
+/* A flat series with one Gaussian bump of a few years to a few decades */
+void gaussian_bump_series(double *series, size_t size, double level)
+{
+	flat_series(series, size, level);
+	add_bump(series, size, level * (2.0 + 20.0 * uniform_sample()));
+}
+
+/* A level that jumps, up or down, by a factor of two to ten at some year */
+void step_series(double *series, size_t size, double level)
+{
+	const size_t step = (size_t) (uniform_sample() * (double) size);
+	double factor = 2.0 + 8.0 * uniform_sample();
+
+	if (uniform_sample() < 0.5)
+		factor = 1.0 / factor;
+	flat_series(series, size, level);
+	for (size_t i = step; i < size; i++)
+		series[i] *= factor;
+}
+
+/* A flat series with num_bursts bumps, which may overlap */
+void multi_burst_series(double *series, size_t size, double level, size_t num_bursts)
+{
+	flat_series(series, size, level);
+	for (size_t k = 0; k < num_bursts; k++)
+		add_bump(series, size, level * (2.0 + 20.0 * uniform_sample()));
+}
+
+/*
+ * A relevance row as the detectors emit it: up to num_events scored years
+ * clustered around a single burst, zero elsewhere.
+ */
+void bursty_relevance_row(int *counts, size_t size, size_t num_events)
+{
+	const double center = uniform_sample() * (double) size;
+	const double width = 1.0 + 20.0 * uniform_sample();
+
+	for (size_t i = 0; i < size; i++)
+		counts[i] = 0;
+	for (size_t k = 0; k < num_events; k++) {
+		double offset = width * (uniform_sample() + uniform_sample() - 1.0);
+		long year = (long) (center + offset);
+		if (year >= 0 && year < (long) size)
+			counts[year] = 1 + (int) (9.0 * uniform_sample());
+	}
+}
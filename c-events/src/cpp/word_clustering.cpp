@@ -0,0 +1,251 @@
+#include "word_clustering.h"
+#include <algorithm>
+#include <cmath>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef void (*range_function)(void *context, size_t thread, size_t begin, size_t end);
+
+struct worker {
+	pthread_t thread;
+	bool started;
+	range_function run;
+	void *context;
+	size_t index, begin, end;
+};
+
+static void *run_worker(void *arg)
+{
+	worker *w = (worker *) arg;
+	w->run(w->context, w->index, w->begin, w->end);
+	return NULL;
+}
+
+/* Splits [0, n) into one contiguous range per thread */
+static void parallel_for(size_t n, size_t num_threads, range_function run, void *context)
+{
+	vector<worker> workers(max(num_threads, (size_t) 1));
+	const size_t step = (n + workers.size() - 1) / workers.size();
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].run = run;
+		workers[t].context = context;
+		workers[t].index = t;
+		workers[t].begin = min(t * step, n);
+		workers[t].end = min((t + 1) * step, n);
+	}
+	for (size_t t = 1; t < workers.size(); t++)
+		workers[t].started = pthread_create(&workers[t].thread, NULL, run_worker,
+			&workers[t]) == 0;
+	run_worker(&workers[0]);
+	/* Ranges that did not get a thread run here */
+	for (size_t t = 1; t < workers.size(); t++) {
+		if (workers[t].started)
+			pthread_join(workers[t].thread, NULL);
+		else
+			run_worker(&workers[t]);
+	}
+}
+
+static uint32_t mix32(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x85ebca6bU;
+	x ^= x >> 13;
+	x *= 0xc2b2ae35U;
+	x ^= x >> 16;
+	return x;
+}
+
+/* Roots are always the smallest word of their set */
+static uint32_t find_root(vector<uint32_t> &parents, uint32_t x)
+{
+	while (parents[x] != x) {
+		parents[x] = parents[parents[x]];
+		x = parents[x];
+	}
+	return x;
+}
+
+static bool join(vector<uint32_t> &parents, uint32_t x, uint32_t y)
+{
+	x = find_root(parents, x);
+	y = find_root(parents, y);
+	if (x == y)
+		return false;
+	if (x < y)
+		parents[y] = x;
+	else
+		parents[x] = y;
+	return true;
+}
+
+struct clustering_context {
+	const sparse_relevance *matrix;
+	const word_clustering_options *options;
+	size_t num_hashes;
+	vector<uint32_t> year_hashes;
+	vector<uint32_t> signatures;
+	vector<float> lengths;
+	vector<uint32_t> words;
+	/* One forest per thread, joined at the end */
+	vector<vector<uint32_t> > forests;
+};
+
+static void compute_signatures(void *arg, size_t, size_t begin, size_t end)
+{
+	clustering_context &context = *(clustering_context *) arg;
+	const sparse_relevance &matrix = *context.matrix;
+
+	for (size_t i = begin; i < end; i++) {
+		const uint32_t row = context.words[i];
+		uint32_t *signature = &context.signatures[i * context.num_hashes];
+		double sum = 0.0;
+		fill(signature, signature + context.num_hashes, (uint32_t) -1);
+		for (uint64_t k = matrix.indptr[row]; k < matrix.indptr[row + 1]; k++) {
+			const uint32_t *hashes = &context.year_hashes[matrix.indices[k] * context.num_hashes];
+			for (size_t h = 0; h < context.num_hashes; h++)
+				signature[h] = min(signature[h], hashes[h]);
+			sum += (double) matrix.values[k] * matrix.values[k];
+		}
+		context.lengths[i] = (float) sqrt(sum);
+	}
+}
+
+static float row_cosine(const clustering_context &context, size_t x, size_t y)
+{
+	const sparse_relevance &matrix = *context.matrix;
+	uint64_t i = matrix.indptr[context.words[x]], i_end = matrix.indptr[context.words[x] + 1];
+	uint64_t j = matrix.indptr[context.words[y]], j_end = matrix.indptr[context.words[y] + 1];
+	float sum = 0.0f;
+
+	while (i < i_end && j < j_end) {
+		if (matrix.indices[i] < matrix.indices[j]) {
+			i++;
+		} else if (matrix.indices[i] > matrix.indices[j]) {
+			j++;
+		} else {
+			sum += matrix.values[i] * matrix.values[j];
+			i++;
+			j++;
+		}
+	}
+	return sum / (context.lengths[x] * context.lengths[y]);
+}
+
+/*
+ * Buckets the words by the hash of each band of their signatures and joins
+ * the ones of a bucket whose rows are really similar. Pairs already in the
+ * same set of this thread are not checked again.
+ */
+static void link_bands(void *arg, size_t thread, size_t begin, size_t end)
+{
+	clustering_context &context = *(clustering_context *) arg;
+	const word_clustering_options &options = *context.options;
+	const size_t num_words = context.words.size();
+	vector<uint32_t> &forest = context.forests[thread];
+	vector<pair<uint64_t, uint32_t> > keys(num_words);
+
+	for (size_t band = begin; band < end; band++) {
+		for (size_t i = 0; i < num_words; i++) {
+			const uint32_t *signature = &context.signatures[i * context.num_hashes +
+				band * options.rows_per_band];
+			uint64_t key = band;
+			for (size_t r = 0; r < options.rows_per_band; r++)
+				key = (key ^ signature[r]) * 0x100000001b3ULL;
+			keys[i] = make_pair(key, (uint32_t) i);
+		}
+		sort(keys.begin(), keys.end());
+
+		for (size_t first = 0; first < num_words; ) {
+			size_t last = first + 1;
+			while (last < num_words && keys[last].first == keys[first].first)
+				last++;
+			for (size_t i = first; i < last; i++) {
+				const size_t window_end = min(last, i + 1 + options.window);
+				for (size_t j = i + 1; j < window_end; j++) {
+					const uint32_t x = keys[i].second, y = keys[j].second;
+					if (find_root(forest, x) != find_root(forest, y) &&
+							row_cosine(context, x, y) >= options.min_similarity)
+						join(forest, x, y);
+				}
+			}
+			first = last;
+		}
+	}
+}
+
+void default_word_clustering_options(word_clustering_options &options)
+{
+	long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	options.num_bands = 16;
+	options.rows_per_band = 1;
+	options.min_similarity = 0.5f;
+	options.window = 64;
+	options.num_threads = num_cpus > 0 ? (size_t) num_cpus : 1;
+}
+
+/*
+ * Groups the words whose relevance rows burst together: the connected
+ * components of the graph that links the words with a cosine of at least
+ * min_similarity, found through MinHash signatures of the years of each
+ * row and locality-sensitive hashing. clusters[w] is the smallest word of
+ * the component of w, and empty rows are left alone.
+ */
+void cluster_words(const sparse_relevance &matrix, const word_clustering_options &options,
+	vector<uint32_t> &clusters)
+{
+	clustering_context context;
+	vector<uint32_t> parents;
+
+	context.matrix = &matrix;
+	context.options = &options;
+	context.num_hashes = options.num_bands * options.rows_per_band;
+	for (size_t row = 0; row < matrix.num_rows; row++)
+		if (matrix.indptr[row + 1] > matrix.indptr[row])
+			context.words.push_back((uint32_t) row);
+
+	context.year_hashes.resize(matrix.num_cols * context.num_hashes);
+	for (size_t year = 0; year < matrix.num_cols; year++)
+		for (size_t h = 0; h < context.num_hashes; h++)
+			context.year_hashes[year * context.num_hashes + h] =
+				mix32(mix32((uint32_t) year) ^ mix32((uint32_t) (h + 1) * 0x9e3779b9U));
+
+	context.signatures.resize(context.words.size() * context.num_hashes);
+	context.lengths.resize(context.words.size());
+	parallel_for(context.words.size(), options.num_threads, compute_signatures, &context);
+
+	const size_t num_forests = max(min(options.num_threads, options.num_bands), (size_t) 1);
+	parents.resize(context.words.size());
+	for (size_t i = 0; i < parents.size(); i++)
+		parents[i] = (uint32_t) i;
+	context.forests.assign(num_forests, parents);
+	parallel_for(options.num_bands, num_forests, link_bands, &context);
+
+	for (size_t t = 0; t < context.forests.size(); t++)
+		for (size_t i = 0; i < parents.size(); i++)
+			join(parents, (uint32_t) i, find_root(context.forests[t], (uint32_t) i));
+
+	clusters.resize(matrix.num_rows);
+	for (size_t row = 0; row < matrix.num_rows; row++)
+		clusters[row] = (uint32_t) row;
+	for (size_t i = 0; i < context.words.size(); i++)
+		clusters[context.words[i]] = context.words[find_root(parents, (uint32_t) i)];
+}
+
+/* One line per word in a cluster of two or more: word, cluster */
+int write_word_clusters(FILE *f, const vector<uint32_t> &clusters)
+{
+	vector<size_t> sizes(clusters.size(), 0);
+
+	for (size_t i = 0; i < clusters.size(); i++)
+		sizes[clusters[i]]++;
+	for (size_t i = 0; i < clusters.size(); i++)
+		if (sizes[clusters[i]] > 1)
+			fprintf(f, "%zu,%u\n", i, clusters[i]);
+
+	return ferror(f) ? -1 : 0;
+}
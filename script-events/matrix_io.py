@@ -13,6 +13,33 @@ def load_csr_matrix(filename):
 	zmat = np.load(filename)
 	return csr_matrix((zmat['data'], zmat['indices'], zmat['indptr']), zmat['shape'], dtype=np.uint8)
 
+RELEVANCE_MATRIX_MAGIC = b'HEVRELM'
+RELEVANCE_HEADER = np.dtype([('magic', 'S8'), ('version', '<u4'), ('format', '<u4'),
+	('num_rows', '<u8'), ('num_cols', '<u8'), ('nnz', '<u8'),
+	('indices_offset', '<u8'), ('data_offset', '<u8'), ('indptr_offset', '<u8')])
+RELEVANCE_CSR = 1
+RELEVANCE_DENSE = 2
+
+def load_relevance_matrix(filename):
+	"""Memory-maps a binary relevance matrix written by the relevance program."""
+	buf = np.memmap(filename, dtype=np.uint8, mode='r')
+	header = np.frombuffer(buf, dtype=RELEVANCE_HEADER, count=1)[0]
+	if header['magic'] != RELEVANCE_MATRIX_MAGIC:
+		raise ValueError('Not a relevance matrix: ' + filename)
+	shape = (int(header['num_rows']), int(header['num_cols']))
+	nnz = int(header['nnz'])
+	if header['format'] == RELEVANCE_DENSE:
+		size = shape[0] * shape[1]
+		return np.frombuffer(buf, dtype=np.uint8, count=size,
+			offset=int(header['data_offset'])).reshape(shape)
+	indices = np.frombuffer(buf, dtype='<i4', count=nnz,
+		offset=int(header['indices_offset']))
+	data = np.frombuffer(buf, dtype=np.uint8, count=nnz,
+		offset=int(header['data_offset']))
+	indptr = np.frombuffer(buf, dtype='<i8', count=shape[0] + 1,
+		offset=int(header['indptr_offset']))
+	return csr_matrix((data, indices, indptr), shape, dtype=np.uint8)
+
 def save_csv_as_csr_matrix(csv_filename, matrix_filename):
 	values = [ ]
 	row_indices = [ ]
@@ -36,8 +63,11 @@ def save_csv_as_csr_matrix(csv_filename, matrix_filename):
 	save_csr_matrix(matrix_filename, matrix)
 
 def transforms_csvs(in_directory, out_directory):
-	filenames = os.listdir(in_directory)
+	"""Converts the CSV relevance files, which predate the binary formats, to npz."""
+	filenames = [filename for filename in os.listdir(in_directory) if filename.endswith('.csv')]
 	filenames.sort()
+	if filenames and not os.path.isdir(out_directory):
+		os.makedirs(out_directory)
 	for filename in filenames:
 		base_filename = os.path.splitext(filename)[0]
 		full_filename = os.path.join(in_directory, filename)
@@ -47,20 +77,29 @@ def transforms_csvs(in_directory, out_directory):
 			save_csv_as_csr_matrix(full_filename, matrix_filename)
 
 def read_matrices(directory):
+	"""Loads the binary relevance matrices and the npz ones, skipping any other file."""
 	filenames = os.listdir(directory)
 	matrices = { }
 	for filename in filenames:
-		base_filename = os.path.splitext(filename)[0]
+		base_filename, extension = os.path.splitext(filename)
 		full_filename = os.path.join(directory, filename)
-		matrix = load_csr_matrix(full_filename)
+		if extension in ('.csr', '.u8'):
+			matrix = load_relevance_matrix(full_filename)
+		elif extension == '.npz':
+			matrix = load_csr_matrix(full_filename)
+		else:
+			continue
 		matrices[base_filename] = matrix
 	return matrices
 
 def main():
-	csv_directory = os.path.join('data', 'relevance')
+	relevance_directory = os.path.join('data', 'relevance')
 	sparse_directory = os.path.join('data', 'sparse_relevance')
-	transforms_csvs(csv_directory, sparse_directory)
-	matrices = read_matrices(sparse_directory)
+	matrices = { }
+	transforms_csvs(relevance_directory, sparse_directory)
+	if os.path.isdir(sparse_directory):
+		matrices.update(read_matrices(sparse_directory))
+	matrices.update(read_matrices(relevance_directory))
 	print(matrices)
 
 if __name__ == '__main__':
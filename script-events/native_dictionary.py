@@ -0,0 +1,111 @@
+#!/usr/bin/python
+from __future__ import print_function
+import ctypes
+import os
+import numpy as np
+
+MIN_YEAR = 1500
+MAX_YEARS = 509
+
+# struct db_entry, padded as the C compiler lays it out
+DB_ENTRY = np.dtype([('word_offset', '<u4'), ('time_offset', '<u4'),
+	('word_length', '<u2'), ('time_length', '<u2'),
+	('total_match_count', '<u8'), ('total_volume_count', '<u8')], align=True)
+
+DEFAULT_LIBRARY = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+	'..', 'c-events', 'bin', 'libevents.so')
+
+def load_library(filename=None):
+	lib = ctypes.CDLL(filename or os.environ.get('EVENTS_LIBRARY', DEFAULT_LIBRARY))
+	lib.mapped_dictionary_open.restype = ctypes.c_void_p
+	lib.mapped_dictionary_open.argtypes = [ ctypes.c_char_p, ctypes.c_char_p ]
+	lib.mapped_dictionary_close.restype = None
+	lib.mapped_dictionary_close.argtypes = [ ctypes.c_void_p ]
+	lib.mapped_dictionary_num_words.restype = ctypes.c_size_t
+	lib.mapped_dictionary_num_words.argtypes = [ ctypes.c_void_p ]
+	lib.mapped_dictionary_entries.restype = ctypes.c_void_p
+	lib.mapped_dictionary_entries.argtypes = [ ctypes.c_void_p ]
+	lib.mapped_dictionary_text.restype = ctypes.c_void_p
+	lib.mapped_dictionary_text.argtypes = [ ctypes.c_void_p ]
+	lib.mapped_dictionary_find.restype = ctypes.c_long
+	lib.mapped_dictionary_find.argtypes = [ ctypes.c_void_p, ctypes.c_char_p ]
+	lib.mapped_dictionary_prefix.restype = None
+	lib.mapped_dictionary_prefix.argtypes = [ ctypes.c_void_p, ctypes.c_char_p,
+		ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_size_t) ]
+	lib.mapped_dictionary_series.restype = None
+	lib.mapped_dictionary_series.argtypes = [ ctypes.c_void_p,
+		ctypes.POINTER(ctypes.c_char_p), ctypes.c_size_t, ctypes.c_uint,
+		ctypes.c_void_p, ctypes.c_void_p ]
+	return lib
+
+def to_bytes(word):
+	return word if isinstance(word, bytes) else word.encode('utf-8')
+
+class NativeDictionary(object):
+	"""The sorted dictionary mapped by libevents.so, without loading anything in Python.
+
+	entries is a structured array over the mapped .main file and stays valid until close().
+	"""
+	def __init__(self, directory, base_filename=None, library=None):
+		if base_filename is None:
+			base_filename = os.path.join('sort', 'googlebooks-eng-all-1gram-20120701-database')
+		total_counts_filename = os.path.join(directory, 'googlebooks-eng-all-totalcounts-20120701.txt')
+		self.lib = library or load_library()
+		self.handle = self.lib.mapped_dictionary_open(
+			to_bytes(os.path.join(directory, base_filename)), to_bytes(total_counts_filename))
+		if not self.handle:
+			raise IOError('Could not map the dictionary in ' + directory)
+		self.num_words = self.lib.mapped_dictionary_num_words(self.handle)
+		self.entries = np.zeros(0, dtype=DB_ENTRY)
+		if self.num_words:
+			buf = (ctypes.c_char * (self.num_words * DB_ENTRY.itemsize)).from_address(
+				self.lib.mapped_dictionary_entries(self.handle))
+			self.entries = np.frombuffer(buf, dtype=DB_ENTRY)
+		self.text = self.lib.mapped_dictionary_text(self.handle)
+
+	def close(self):
+		if self.handle:
+			self.entries = None
+			self.lib.mapped_dictionary_close(self.handle)
+			self.handle = None
+
+	def __del__(self):
+		self.close()
+
+	def word(self, index):
+		entry = self.entries[index]
+		return ctypes.string_at(self.text + int(entry['word_offset']), int(entry['word_length']))
+
+	def find(self, word):
+		"""The index of the word, or -1."""
+		return self.lib.mapped_dictionary_find(self.handle, to_bytes(word))
+
+	def prefix(self, prefix):
+		"""The range [first, last) of the words which start with the prefix."""
+		first, last = ctypes.c_size_t(), ctypes.c_size_t()
+		self.lib.mapped_dictionary_prefix(self.handle, to_bytes(prefix),
+			ctypes.byref(first), ctypes.byref(last))
+		return first.value, last.value
+
+	def series(self, words, smoothing_window=0):
+		"""The (n, 509) frequencies of the words and their indices, -1 for unknown words."""
+		words = [ to_bytes(word) for word in words ]
+		series = np.empty((len(words), MAX_YEARS), dtype=np.float64)
+		indices = np.empty(len(words), dtype=np.dtype(ctypes.c_long))
+		if words:
+			c_words = (ctypes.c_char_p * len(words))(*words)
+			self.lib.mapped_dictionary_series(self.handle, c_words, len(words),
+				smoothing_window, series.ctypes.data, indices.ctypes.data)
+		return series, indices
+
+	def get_time_series(self, word, smoothing_window=0):
+		"""Same as NgramDatabase.get_time_series."""
+		return list(self.series([ word ], smoothing_window)[0][0])
+
+def main():
+	ngram_db = NativeDictionary('data')
+	series, indices = ngram_db.series([ 'Microsoft', 'Apple' ], 3)
+	print(indices, series.shape)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,27 @@
+#!/usr/bin/python
+from __future__ import print_function
+import json
+import socket
+
+def query_series(socket_path, words, smoothing, year_start, year_end, models):
+	"""Asks series_server for the series and relevance rows of many words at once."""
+	fields = [ str(smoothing), str(year_start), str(year_end), ','.join(models) ]
+	request = '\t'.join(fields + list(words)) + '\n'
+	sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+	try:
+		sock.connect(socket_path)
+		sock.sendall(request.encode('utf-8'))
+		line = sock.makefile('rb').readline()
+	finally:
+		sock.close()
+	answer = json.loads(line.decode('utf-8'))
+	if 'error' in answer:
+		raise ValueError(answer['error'])
+	return answer
+
+def main():
+	answer = query_series('data/series.sock', [ 'Microsoft' ], 0, 1900, 2008, [ ])
+	print(answer['words'][0]['series'])
+
+if __name__ == '__main__':
+	main()
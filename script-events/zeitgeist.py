@@ -31,13 +31,24 @@ def filter_word_pairs(word_pairs):
 				word_map[word] = mult
 	return word_map.iteritems()
 
-def index_summary(filename):
+def read_word_ids(filename):
+	word_ids = { }
+	with open(filename) as f:
+		for line in f:
+			tokens = line.rstrip('\n').split('\t', 1)
+			if len(tokens) == 2:
+				word_ids[tokens[0]] = tokens[1]
+	return word_ids
+
+def index_summary(filename, word_ids=None):
 	idx = [ [] for _ in xrange(num_years) ]
 	with open(filename) as f:
 		for line in f:
 			tokens = line.rstrip().split()
 			if len(tokens) >= 2:
 				word = tokens[0]
+				if word_ids is not None:
+					word = word_ids.get(word)
 				if is_valid_word(word):
 					try:
 						year = int(tokens[1])
@@ -94,7 +105,11 @@ def main():
 		pos = len(filename) - len(summary_suffix)
 		prefix = filename[0:pos]
 		summary_filename = os.path.join(summary_directory, filename)
-		idx = index_summary(summary_filename)
+		ids_filename = os.path.join(summary_directory, prefix + '_summary.ids')
+		word_ids = None
+		if os.path.isfile(ids_filename):
+			word_ids = read_word_ids(ids_filename)
+		idx = index_summary(summary_filename, word_ids)
 
 		history_filename = os.path.join(history_directory, '%s_history.csv' % (prefix,))
 		with open(history_filename, 'w') as f:
@@ -1,11 +1,16 @@
+import os
 from django.conf.urls import patterns, url
 
 from main import dictionary
 from main import matrix_io
 from main import views
 
-views.ngram_db = dictionary.load_dictionary('../data')
-views.matrices = matrix_io.read_matrices('../data/sparse_relevance')
+# Queries go to series_server when it runs, which spares loading everything here
+if os.path.exists('../data/series.sock'):
+	views.series_socket = '../data/series.sock'
+else:
+	views.ngram_db = dictionary.load_dictionary('../data')
+	views.matrices = matrix_io.read_matrices('../data/relevance')
 
 urlpatterns = patterns('',
     url(r'^$', views.index, name='index'),
@@ -4,8 +4,11 @@ from django.http import HttpResponse
 from django.shortcuts import get_object_or_404, render_to_response
 from django.template import RequestContext
 
+from main import series_client
+
 ngram_db = None
 matrices = None
+series_socket = None
 
 def get_actual_year(year):
 	if year < 1500:
@@ -29,6 +32,28 @@ def row_to_series(row):
 		series[index] = int(data[i])
 	return series
 
+def lookup_local(tokens, smoothing, year_start, year_end, model_set):
+	lookups = [ ]
+	for word in tokens:
+		series = ngram_db.get_time_series(word, smoothing)
+		index = ngram_db.word_indices.get(word, 0)
+		series = series[(year_start - 1500):(year_end - 1500 + 1)]
+		rows = [ ]
+		for model_type, matrix in matrices.iteritems():
+			if model_type in model_set:
+				row = matrix.getrow(index)
+				row_series = row_to_series(row)
+				rows.append((model_type, row_series[(year_start - 1500):(year_end - 1500 + 1)]))
+		lookups.append((series, rows))
+	return lookups
+
+def lookup_server(tokens, smoothing, year_start, year_end, model_set):
+	models = sorted(model_set - set([ 'time_series' ]))
+	answer = series_client.query_series(series_socket, tokens, smoothing,
+		year_start, year_end, models)
+	return [ (entry['series'], sorted(entry['relevance'].items()))
+		for entry in answer['words'] ]
+
 def graph(request):
 	global ngram_db, matrices
 	result = { }
@@ -50,26 +75,22 @@ def graph(request):
 		ngrams = [ ]
 		relevances = [ ]
 		local_maxima = [ ]
-		for i, word in enumerate(tokens):
-			series = ngram_db.get_time_series(word, smoothing)
-			index = ngram_db.word_indices.get(word, 0)
-			series = series[(year_start - 1500):(year_end - 1500 + 1)]
-
+		if series_socket is not None:
+			lookups = lookup_server(tokens, smoothing, year_start, year_end, model_set)
+		else:
+			lookups = lookup_local(tokens, smoothing, year_start, year_end, model_set)
+		for word, (series, rows) in zip(tokens, lookups):
 			local_maxima.append(max(series))
 			ngrams.append({
 				'word': word,
 				'series': series,
 			})
 
-			for model_type, matrix in matrices.iteritems():
-				if model_type in model_set:
-					row = matrix.getrow(index)
-					row_series = row_to_series(row)
-					row_series = row_series[(year_start - 1500):(year_end - 1500 + 1)]
-					relevances.append({
-						'word': '%s (%s)' % (word, model_type.replace('_', ' ')),
-						'series': row_series,
-					})
+			for model_type, row_series in rows:
+				relevances.append({
+					'word': '%s (%s)' % (word, model_type.replace('_', ' ')),
+					'series': row_series,
+				})
 
 		if 'time_series' in model_set:
 			indexed_maxima = list(enumerate(local_maxima))